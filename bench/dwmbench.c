@@ -0,0 +1,329 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * dwmbench drives a running dwm with synthetic clients and reports latency
+ * percentiles. It maps, retitles, resizes and destroys windows, and switches
+ * tags, layouts and focus through the query socket. bench/run.sh starts it
+ * against a dwm on a private Xvfb.
+ */
+#include <poll.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include "sockdef.h"
+
+#define TIMEOUT 2000000 /* us to wait for dwm to react */
+
+typedef struct {
+	const char *name;
+	double *v; /* us */
+	size_t n, size;
+	unsigned int timeouts;
+} Samples;
+
+static Display *dpy;
+static Window root;
+static Atom activeatom;
+static int sock;
+static uint32_t nextid;
+
+static Samples mapped = { "map" }, viewed = { "view" }, arranged = { "arrange" },
+	focused = { "focus" };
+
+static void
+die(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+	exit(1);
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void
+add(Samples *s, double v)
+{
+	if (s->n == s->size) {
+		s->size = s->size ? 2 * s->size : 256;
+		if (!(s->v = realloc(s->v, s->size * sizeof(double))))
+			die("dwmbench: out of memory");
+	}
+	s->v[s->n++] = v;
+}
+
+static int
+cmpdouble(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* nearest rank */
+static double
+percentile(const Samples *s, unsigned int p)
+{
+	size_t i = (p * s->n + 99) / 100;
+
+	return s->v[i ? i - 1 : 0];
+}
+
+static void
+report(Samples *s)
+{
+	if (!s->n) {
+		printf("%-8s %6d %9s %9s %9s %9s %8u\n", s->name, 0, "-", "-", "-",
+		       "-", s->timeouts);
+		return;
+	}
+	qsort(s->v, s->n, sizeof(double), cmpdouble);
+	printf("%-8s %6zu %9.3f %9.3f %9.3f %9.3f %8u\n", s->name, s->n,
+	       percentile(s, 50) / 1e3, percentile(s, 90) / 1e3,
+	       percentile(s, 99) / 1e3, s->v[s->n - 1] / 1e3, s->timeouts);
+}
+
+static void
+sendall(const void *buf, size_t len)
+{
+	ssize_t r;
+
+	for (; len; buf = (const char *)buf + r, len -= r)
+		if ((r = send(sock, buf, len, 0)) <= 0)
+			die("dwmbench: lost the connection to dwm");
+}
+
+static void
+recvall(void *buf, size_t len)
+{
+	ssize_t r;
+
+	for (; len; buf = (char *)buf + r, len -= r)
+		if ((r = recv(sock, buf, len, 0)) <= 0)
+			die("dwmbench: lost the connection to dwm");
+}
+
+/* Sends a query and waits for its response, returns its status. */
+static int32_t
+query(const char *fmt, ...)
+{
+	char text[MAXBUFF_QUERY], out[MAXBUFF_QUERY];
+	uint32_t len, id = nextid++, rid;
+	int32_t status;
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(text, sizeof(text), fmt, ap);
+	va_end(ap);
+	len = sizeof(id) + strlen(text);
+	sendall(&len, sizeof(len));
+	sendall(&id, sizeof(id));
+	sendall(text, strlen(text));
+	do {
+		recvall(&len, sizeof(len));
+		if (len < sizeof(rid) + sizeof(status) ||
+		    len - sizeof(rid) - sizeof(status) > sizeof(out))
+			die("dwmbench: invalid response of length %u", len);
+		recvall(&rid, sizeof(rid));
+		recvall(&status, sizeof(status));
+		recvall(out, len - sizeof(rid) - sizeof(status));
+	} while (rid != id);
+	return status;
+}
+
+/* Returns once dwm has handled everything sent so far. A query is answered
+ * before dwm arranges, so it takes a second one, which is read in the next
+ * iteration of its event loop, after the layout work. */
+static void
+settle(void)
+{
+	query("tags");
+	XSync(dpy, False);
+}
+
+static void
+drain(void)
+{
+	XEvent ev;
+
+	while (XPending(dpy))
+		XNextEvent(dpy, &ev);
+}
+
+static int
+waitevent(int type, Window w, Atom atom)
+{
+	XEvent ev;
+	struct pollfd pfd = { ConnectionNumber(dpy), POLLIN, 0 };
+	double end = now() + TIMEOUT;
+
+	for (;;) {
+		while (XPending(dpy)) {
+			XNextEvent(dpy, &ev);
+			if (ev.type == type && ev.xany.window == w &&
+			    (type != PropertyNotify || ev.xproperty.atom == atom))
+				return 1;
+		}
+		if (now() >= end || poll(&pfd, 1, (end - now()) / 1000 + 1) <= 0)
+			return 0;
+	}
+}
+
+static void
+connectdwm(void)
+{
+	struct sockaddr_un addr;
+	const char *path;
+
+	if (!(path = getenv(SOCKET_ENV)))
+		path = SOCKET_PATH;
+	if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+		die("dwmbench: could not create socket");
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+		die("dwmbench: could not connect to %s", path);
+}
+
+static Window
+mapclient(int i)
+{
+	XClassHint ch = { "dwmbench", "DwmBench" };
+	char name[64];
+	Window w;
+	double t;
+
+	w = XCreateSimpleWindow(dpy, root, 0, 0, 200, 100, 0, 0, 0);
+	XSelectInput(dpy, w, StructureNotifyMask);
+	snprintf(name, sizeof(name), "dwmbench %d", i);
+	XStoreName(dpy, w, name);
+	XSetClassHint(dpy, w, &ch);
+	t = now();
+	XMapWindow(dpy, w);
+	XFlush(dpy);
+	if (waitevent(MapNotify, w, None))
+		add(&mapped, now() - t);
+	else
+		mapped.timeouts++;
+	return w;
+}
+
+static void
+timequery(Samples *s, const char *q)
+{
+	double t = now();
+
+	if (query("signal %s", q) != 0)
+		die("dwmbench: dwm could not run %s", q);
+	settle();
+	add(s, now() - t);
+}
+
+static void
+timefocus(const char *q)
+{
+	double t;
+
+	drain();
+	t = now();
+	if (query("signal %s", q) != 0)
+		die("dwmbench: dwm could not run %s", q);
+	if (waitevent(PropertyNotify, root, activeatom))
+		add(&focused, now() - t);
+	else
+		focused.timeouts++;
+}
+
+static void
+usage(void)
+{
+	die("usage: dwmbench [-n windows] [-r rounds]");
+}
+
+int
+main(int argc, char *argv[])
+{
+	Window *wins;
+	char name[64];
+	int i, r, n = 50, rounds = 20;
+
+	for (i = 1; i < argc; i++) {
+		if (i + 1 == argc)
+			usage();
+		else if (!strcmp(argv[i], "-n"))
+			n = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-r"))
+			rounds = atoi(argv[++i]);
+		else
+			usage();
+	}
+	if (n < 2 || rounds < 1)
+		usage();
+
+	if (!(dpy = XOpenDisplay(NULL)))
+		die("dwmbench: cannot open display");
+	root = DefaultRootWindow(dpy);
+	activeatom = XInternAtom(dpy, "_NET_ACTIVE_WINDOW", False);
+	XSelectInput(dpy, root, PropertyChangeMask);
+	connectdwm();
+	if (!(wins = calloc(n, sizeof(Window))))
+		die("dwmbench: out of memory");
+
+	for (i = 0; i < n; i++)
+		wins[i] = mapclient(i);
+	settle();
+
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < n; i++) {
+			snprintf(name, sizeof(name), "dwmbench %d round %d", i, r);
+			XStoreName(dpy, wins[i], name);
+			XResizeWindow(dpy, wins[i], 200 + (i + r) % 100, 100 + r % 50);
+		}
+		settle();
+		drain();
+
+		timequery(&viewed, "viewex ui 1");
+		timequery(&viewed, "viewex ui 0");
+		timequery(&arranged, "setmfact f 0.05");
+		timequery(&arranged, "setlayout");
+		timequery(&arranged, "setlayout");
+		timequery(&arranged, "setmfact f -0.05");
+		timefocus("focusstack i 1");
+		timefocus("focusstack i -1");
+	}
+
+	for (i = 0; i < n; i++)
+		XDestroyWindow(dpy, wins[i]);
+	settle();
+
+	printf("%-8s %6s %9s %9s %9s %9s %8s\n", "ms", "n", "p50", "p90", "p99",
+	       "max", "timeouts");
+	report(&mapped);
+	report(&viewed);
+	report(&arranged);
+	report(&focused);
+
+	free(wins);
+	close(sock);
+	XCloseDisplay(dpy);
+	return mapped.timeouts || focused.timeouts;
+}
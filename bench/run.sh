@@ -0,0 +1,46 @@
+#!/bin/sh
+# Runs dwmbench against a dwm of this tree on a private Xvfb display.
+# usage: bench/run.sh [dwmbench options]
+# BENCH_DISPLAY selects the display, :99 by default.
+
+cd "$(dirname "$0")/.." || exit 1
+
+display=${BENCH_DISPLAY:-:99}
+tmp=$(mktemp -d) || exit 1
+xvfbpid=
+dwmpid=
+
+cleanup() {
+	[ -n "$dwmpid" ] && kill "$dwmpid" 2>/dev/null
+	[ -n "$xvfbpid" ] && kill "$xvfbpid" 2>/dev/null
+	wait 2>/dev/null
+	rm -rf "$tmp"
+}
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+# waits up to 5s for a file to appear
+waitfor() {
+	i=0
+	while [ ! -e "$1" ]; do
+		i=$((i + 1))
+		if [ "$i" -gt 50 ]; then
+			echo "run.sh: $2 did not start, see $3:" >&2
+			cat "$3" >&2
+			return 1
+		fi
+		sleep 0.1
+	done
+}
+
+Xvfb "$display" -screen 0 1920x1080x24 -nolisten tcp >"$tmp/xvfb.log" 2>&1 &
+xvfbpid=$!
+waitfor "/tmp/.X11-unix/X${display#:}" Xvfb "$tmp/xvfb.log" || exit 1
+
+export DISPLAY="$display"
+export DWM_SOCKET="$tmp/dwm_socket"
+./dwm >"$tmp/dwm.log" 2>&1 &
+dwmpid=$!
+waitfor "$DWM_SOCKET" dwm "$tmp/dwm.log" || exit 1
+
+./bench/dwmbench "$@"
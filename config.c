@@ -84,8 +84,12 @@ CALC_SIZE(rules);
 // static char tagswap_cmd_number[2] = "1";
 // static const char * tagswap_cmd[] = { "swapbg", tagswap_cmd_number /* Will be later replaced */, "-q", NULL };
 
-/* Cmd to update the external bar */
-const char * barupdate_cmd[] = { "polybar-msg", "hook", "dwmtags", "1", NULL };
+/* The state of the bar is published in the _DWM_BAR_STATE property of the
+ * root window, e.g. for `xprop -root -spy _DWM_BAR_STATE`, or see `dwmq subscribe`.
+ * Cmd to additionally run after an update, NULL runs nothing. */
+const char * barupdate_cmd[] = { NULL };
+/* const char * barupdate_cmd[] = { "polybar-msg", "hook", "dwmtags", "1", NULL }; */
+const int barupdatedebounce  = 0;        /* ms to collect changes for one bar update; 0 updates after every event batch */
 
 /* key definitions */
 #define MODKEY Mod4Mask
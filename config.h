@@ -40,6 +40,7 @@ extern const Rule rules[];
 extern const size_t rules_size;
 
 extern const char * barupdate_cmd[];
+extern const int barupdatedebounce;
 
 extern Key keys[];
 extern const size_t keys_size;
@@ -14,6 +14,10 @@ X11LIB = /usr/X11R6/lib
 XINERAMALIBS  = -lXinerama
 XINERAMAFLAGS = -DXINERAMA
 
+# X request counters (dwmq xstats, kill -USR1 dumps them to stderr),
+# uncomment if you want them
+#XSTATSFLAGS = -DXSTATS
+
 # freetype
 FREETYPELIBS = -lfontconfig -lXft
 FREETYPEINC = /usr/include/freetype2
@@ -22,14 +26,14 @@ FREETYPEINC = /usr/include/freetype2
 
 # includes and libs
 INCS = -I${X11INC} -I${FREETYPEINC}
-LIBS = -L${X11LIB} -lX11 ${XINERAMALIBS} ${FREETYPELIBS} -lXrender -lX11-xcb -lxcb -lxcb-res -lXext
+LIBS = -L${X11LIB} -lX11 ${XINERAMALIBS} ${FREETYPELIBS} -lXrender -lX11-xcb -lxcb -lxcb-res -lXext -lm
 
 # flags
-CPPFLAGS = -D_DEFAULT_SOURCE -D_BSD_SOURCE -D_POSIX_C_SOURCE=200809L -DVERSION=\"${VERSION}\" ${XINERAMAFLAGS}
+CPPFLAGS = -D_DEFAULT_SOURCE -D_BSD_SOURCE -D_POSIX_C_SOURCE=200809L -DVERSION=\"${VERSION}\" ${XINERAMAFLAGS} ${XSTATSFLAGS}
 # CFLAGS_OPT= -Os
 CFLAGS_OPT= -O0
-CFLAGS   = -g -std=c99 -pedantic -Wall -Wno-deprecated-declarations -pthread ${CFLAGS_OPT} ${INCS} ${CPPFLAGS}
-LDFLAGS  = ${LIBS} -pthread
+CFLAGS   = -g -std=c99 -pedantic -Wall -Wno-deprecated-declarations ${CFLAGS_OPT} ${INCS} ${CPPFLAGS}
+LDFLAGS  = ${LIBS}
 
 # compiler and linker
 CC = cc
@@ -11,6 +11,13 @@
  * whenever a new event has been fetched. This allows event dispatching
  * in O(1) time.
  *
+ * The X connection, the query socket, signals and timers are all served by a
+ * single epoll loop in run(), without any threads.
+ *
+ * Events are handled in batches: all events already queued are dispatched
+ * first, handlers only mark monitors for rearrangement, and every marked
+ * monitor is then arranged and restacked once at the end of the batch.
+ *
  * Each child of the root window is called a client, except windows which have
  * set the override_redirect flag. Clients are organized in a linked client
  * list on each monitor, the focus history is remembered through a stack list
@@ -21,6 +28,7 @@
  *
  * To understand everything else, start reading main().
  */
+#define _GNU_SOURCE /* accept4(), POSIX_SPAWN_SETSID */
 #include <X11/Xatom.h>
 #include <X11/Xlib.h>
 #include <X11/Xproto.h>
@@ -29,17 +37,25 @@
 #include <X11/cursorfont.h>
 #include <X11/keysym.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <locale.h>
-#include <pthread.h>
+#include <math.h>
+#include <poll.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
 #include <sys/socket.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 #ifdef XINERAMA
 #include <X11/extensions/Xinerama.h>
@@ -53,8 +69,13 @@
 #include "dwm.h"
 #include "config.h"
 #include "layouts.h"
+#include "proctree.h"
+#include "rules.h"
 #include "external_cmds.h"
+#include "sighash.h"
+#include "stats.h"
 #include "util.h"
+#include "winmap.h"
 
 /* variables */
 static const char broken[] = "broken";
@@ -77,6 +98,24 @@ static void (*handler[LASTEvent])(XEvent *) = {
     [MotionNotify] = motionnotify,
     [PropertyNotify] = propertynotify,
     [UnmapNotify] = unmapnotify};
+static const char *handlernames[LASTEvent] = {
+    [ButtonPress] = "ButtonPress",
+    [ClientMessage] = "ClientMessage",
+    [ConfigureRequest] = "ConfigureRequest",
+    [ConfigureNotify] = "ConfigureNotify",
+    [DestroyNotify] = "DestroyNotify",
+    [EnterNotify] = "EnterNotify",
+    [FocusIn] = "FocusIn",
+    [KeyPress] = "KeyPress",
+    [MappingNotify] = "MappingNotify",
+    [MapRequest] = "MapRequest",
+    [MotionNotify] = "MotionNotify",
+    [PropertyNotify] = "PropertyNotify",
+    [UnmapNotify] = "UnmapNotify"};
+/* latencies shown by the stats query */
+static Stat *handlerstats[LASTEvent];
+static Stat *arrangestat, *managestat, *focusstat;
+static Stat **querystats; /* by index in query_funcs */
 static Atom wmatom[WMLast], netatom[NetLast];
 static int restart = 0;
 static int running = 1;
@@ -97,20 +136,115 @@ static Colormap cmap;
 Clientlist *cl;
 static Pertag *pertagglist;
 
-static AnimateThreadArg *animatequeue;
-static pthread_mutex_t animatemutex;
-
-static int querysocket;
-static pthread_t querysocket_thread;
+/* window -> client indices, the second one maps the windows of swallowed
+ * clients to the client swallowing them */
+static WinMap clientmap;
+static WinMap swallowmap;
+
+/* running animations, advanced together on every expiration of animtimer */
+static Animation *animations;
+static EventSource animtimer = {-1, animateclient_tick};
+
+/* clients whose geometry changed, but was not sent to the server yet */
+static Client **configqueue;
+static unsigned int configqueuelen, configqueuesize;
+
+#ifdef XSTATS
+XStats xstats;
+/* counters of the code path dwm is in, and of those it was entered from */
+static XStats xstatsctx[XCtxLast + LASTEvent];
+XStats *xstatscur = &xstatsctx[XCtxOther];
+static XStats *xstatsstack[16];
+static unsigned int xstatsdepth;
+static unsigned long xstatsmark; /* NextRequest() when xstatscur was entered */
+static uint64_t xstatsgrabbed;
+static const char *xstatsnames[XCtxLast] = {"other", "arrange", "focus",
+					     "restack", "corners"};
+#endif /* XSTATS */
+
+/* rounded corners, insets of the rows per radius */
+static unsigned short **cornertabs;
+static int ncornertabs;
+static XRectangle *shaperects;
+static int shaperectssize;
+
+/* all file descriptors are served by one epoll loop in run() */
+static int epollfd = -1;
+static EventSource xsource = {-1, NULL}; /* events are read by Xlib */
+static EventSource sigsource = {-1, handlesignals};
+static sigset_t handledsignals;
+static EventSource querysocket = {-1, querysocket_accept};
+static const char *socketpath;
+static EventSource proctreesrc = {-1, proctree_handle};
+static QueryClient *queryclients;
+
+/* key bindings by keycode, those of keycode k are at
+ * keybindings[keystart[k]] up to keybindings[keystart[k + 1]] */
+static KeyBinding *keybindings;
+static unsigned int nkeybindings;
+static unsigned int keystart[256 + 1];
+
+/* latencies of commands started by spawn() */
+LaunchStats launchstats[MAXLAUNCHSTATS];
+int nlaunchstats;
+LaunchStats *lastlaunch;
+static Launch launches[64]; /* children that did not map a window yet */
+static unsigned int nextlaunch;
+
+/* the bar is updated once after a batch of changes */
+static int barpending;
+static EventSource bartimer = {-1, barupdate_tick};
+static Atom barstateatom;
+
+/* windows of all clients in the order they were managed, written to
+ * _NET_CLIENT_LIST once per batch of events */
+static Window *clientlist;
+static unsigned int nclientlist, clientlistsize;
+static int clientlistdirty;
+/* the same windows from the bottom to the top of the stack, written to
+ * _NET_CLIENT_LIST_STACKING; it has room for clientlistsize windows */
+static Window *stackinglist;
+static int stackingdirty;
+
+/* state last published to subscribers, and what may have changed since */
+static unsigned int subpending = SubAll;
+static Window pubsel;
+static unsigned int pubocc, puburg;
+static int pubnmons;
 
 unsigned int gappx;
 static xcb_connection_t *xcon;
 
 static int overviewmode;
 
+/* all clients, in slabs so that walks over them stay close together */
+static Pool clientpool, coldpool;
+
+/* bumped whenever the tiled clients of a monitor may have changed */
+static unsigned int tiledgen = 1;
+
 /* configuration, allows nested code to access above variables */
 #include "sockdef.h"
 
+/* Cookies of all requests manage() sends for a new window, before waiting
+ * for the first reply. */
+typedef struct {
+  xcb_res_query_client_ids_cookie_t pid;
+  xcb_get_property_cookie_t netwmname, wmname, trans, class, state, wtype,
+      normalhints, hints;
+} PropCookies;
+
+static void sendprops(Window w, PropCookies *ck);
+static xcb_get_property_reply_t *recvprop(xcb_get_property_cookie_t ck,
+					  Atom type, int format);
+static int recvtextprop(xcb_get_property_cookie_t ck, char *text,
+			unsigned int size);
+static int recvclass(xcb_get_property_cookie_t ck, char *class,
+		     char *instance, unsigned int size);
+static int recvsizehints(xcb_get_property_cookie_t ck, XSizeHints *size);
+static int recvwmhints(xcb_get_property_cookie_t ck, XWMHints *wmh);
+static pid_t recvpid(xcb_res_query_client_ids_cookie_t ck);
+
 /* Needs to be here, because tags is only defined in config.h. */
 struct Pertag {
   unsigned int curtag, prevtag;     /* current and previous tag */
@@ -121,126 +255,186 @@ struct Pertag {
       *ltidxs[NUMTAGS + 1][2]; /* matrix of tags and layouts indexes  */
 };
 
-void animateclient(Client *c, int x, int y, int w, int h) {
-  Client *ct;
-  int oldx = c->x;
-  int oldy = c->y;
-  int oldw = c->w;
-  int oldh = c->h;
-  int frame, n;
-  int maxframes = animationframes;
-
-  for (n = 0, ct = nexttiled(c->mon->cl->clients, c->mon); ct;
-       ct = nexttiled(ct->next, ct->mon), n++)
-    ;
-  if (frreducstart >= 0 && n >= frreducstart)
-    maxframes = animationframes - framereduction * (n - frreducstart + 1);
+/* Starts to move the client to the given geometry. All running animations
+ * are advanced together by animateclient_frame(), whenever animtimer expires.
+ * An animation that is already running is retargeted from the current
+ * position of the client. */
+void animateclient_start(Client *c, int x, int y, int w, int h) {
+  Animation *a;
+  unsigned int n;
+  int frames = animationframes;
+  struct itimerspec its;
+
+  tiledclients(c->mon, &n);
+  if (frreducstart >= 0 && (int)n >= frreducstart)
+    frames = animationframes - framereduction * (n - frreducstart + 1);
+  if (frames <= 0) {
+    resizeclient(c, x, y, w, h);
+    return;
+  }
 
-  for (frame = 0; frame < maxframes; frame++) {
-    double ratio = (double)frame / maxframes;
-    pthread_mutex_lock(&animatemutex);
-    resizeclient(c, oldx + ratio * (x - oldx), oldy + ratio * (y - oldy),
-		 c->animateresize ? oldw + ratio * (w - oldw) : w,
-		 c->animateresize ? oldh + ratio * (h - oldh) : h);
-    pthread_mutex_unlock(&animatemutex);
-    usleep(framedur);
+  if ((a = animateclient_find(c))) {
+    if (a->x == x && a->y == y && a->w == w && a->h == h)
+      return; /* already on its way */
+    a->fromx = c->x;
+    a->fromy = c->y;
+    a->fromw = c->w;
+    a->fromh = c->h;
+    a->x = x;
+    a->y = y;
+    a->w = w;
+    a->h = h;
+    a->frame = 0;
+    a->frames = frames;
+    return;
   }
 
-  pthread_mutex_lock(&animatemutex);
-  resizeclient(c, x, y, w, h);
-  pthread_mutex_unlock(&animatemutex);
+  a = ecalloc(1, sizeof(Animation));
+  a->c = c;
+  a->fromx = c->x;
+  a->fromy = c->y;
+  a->fromw = c->w;
+  a->fromh = c->h;
+  a->x = x;
+  a->y = y;
+  a->w = w;
+  a->h = h;
+  a->frames = frames;
+  a->next = animations;
+  its.it_interval.tv_sec = framedur / 1000000;
+  its.it_interval.tv_nsec = framedur % 1000000 * 1000L;
+  its.it_value = its.it_interval;
+  if (!animations && timerfd_settime(animtimer.fd, 0, &its, NULL) == -1) {
+    fprintf(stderr, "animateclient: could not start the frame timer!\n");
+    free(a);
+    resizeclient(c, x, y, w, h);
+    return;
+  }
+  animations = a;
 }
 
-void *animateclient_thread(void *arg1) {
-  AnimateThreadArg *arg2 = (AnimateThreadArg *)arg1;
-  animateclient(arg2->c, arg2->x, arg2->y, arg2->w, arg2->h);
-  return NULL;
-}
+/* Advances all animations by the frames that passed since the last call,
+ * sends their configures and flushes once. Does nothing, if the timer did not
+ * expire yet. */
+void animateclient_frame(void) {
+  Animation *a, **ap;
+  uint64_t expired;
+  double ratio;
+  struct itimerspec its = {{0}, {0}};
 
-void animateclient_start(Client *c, int x, int y, int w, int h) {
-  AnimateThreadArg *new = malloc(sizeof(AnimateThreadArg));
-  new->c = c;
-  new->x = x;
-  new->y = y;
-  new->h = h;
-  new->w = w;
-  if (pthread_create(&(new->thread), NULL, animateclient_thread, new) != 0) {
-    fprintf(stderr, "animateclient: could not create new thread!\n");
-    resizeclient(c, x, y, w, h);
-    free(new);
+  if (read(animtimer.fd, &expired, sizeof(expired)) != sizeof(expired))
     return;
+  for (ap = &animations; (a = *ap);) {
+    a->frame += expired;
+    if (a->frame >= a->frames) {
+      setclientgeom(a->c, a->x, a->y, a->w, a->h);
+      sendconfigure(a->c);
+      *ap = a->next;
+      free(a);
+      continue;
+    }
+    ratio = (double)a->frame / a->frames;
+    setclientgeom(a->c, a->fromx + ratio * (a->x - a->fromx),
+		  a->fromy + ratio * (a->y - a->fromy),
+		  a->c->animateresize ? a->fromw + ratio * (a->w - a->fromw) : a->w,
+		  a->c->animateresize ? a->fromh + ratio * (a->h - a->fromh) : a->h);
+    sendconfigure(a->c);
+    ap = &a->next;
   }
-  new->next = animatequeue;
-  animatequeue = new;
+  XFlush(dpy);
+  if (!animations)
+    timerfd_settime(animtimer.fd, 0, &its, NULL);
 }
 
-void animateclient_endall() {
-  while (animatequeue != NULL) {
-    if (pthread_join(animatequeue->thread, NULL) != 0) {
-      fprintf(stderr, "Could not join Animation Thread.\n");
+/* Stops the animation of the client, without touching its geometry. Needs to
+ * be called, before an animated client is freed. */
+void animateclient_cancel(Client *c) {
+  Animation *a, **ap;
+  struct itimerspec its = {{0}, {0}};
+
+  for (ap = &animations; (a = *ap); ap = &a->next)
+    if (a->c == c) {
+      *ap = a->next;
+      free(a);
+      break;
     }
-    AnimateThreadArg *next = animatequeue->next;
-    free(animatequeue);
-    animatequeue = next;
+  if (!animations)
+    timerfd_settime(animtimer.fd, 0, &its, NULL);
+}
+
+Animation *animateclient_find(Client *c) {
+  Animation *a;
+
+  for (a = animations; a && a->c != c; a = a->next)
+    ;
+  return a;
+}
+
+void animateclient_tick(EventSource *src, unsigned int events) {
+  animateclient_frame();
+}
+
+/* Runs all animations to their end. */
+void animateclient_endall(void) {
+  struct pollfd pfd = {.fd = animtimer.fd, .events = POLLIN};
+
+  while (animations) {
+    if (poll(&pfd, 1, -1) == -1 && errno != EINTR)
+      break;
+    animateclient_frame();
   }
 }
 
 /* function implementations */
-void applyrules(Client *c) {
-  const char *class, *instance;
+void applyrules(Client *c, const char *class, const char *instance) {
   unsigned int i;
+  size_t j, nmatched;
+  const unsigned int *matched;
   const Rule *r;
   Monitor *m;
-  XClassHint ch = {NULL, NULL};
   const Layout *newLayout = NULL;
 
   /* setting defaults */
   c->tags = 0;
   c->isfloating = 0;
-  c->noswallow = -1;
-  c->isterminal = 0;
+  c->cold->noswallow = -1;
+  c->cold->isterminal = 0;
   c->useresizehints = resizehints;
   c->hasroundcorners = 1;
   c->animate = 1;
   c->animateresize = 1;
 
-  XGetClassHint(dpy, c->win, &ch);
-  class = ch.res_class ? ch.res_class : broken;
-  instance = ch.res_name ? ch.res_name : broken;
-
-  for (i = 0; i < rules_size; i++) {
-    r = &rules[i];
-    if ((!r->title || strstr(c->name, r->title)) &&
-	(!r->class || strstr(class, r->class)) &&
-	(!r->instance || strstr(instance, r->instance))) {
-      if (r->isterminal)
-	c->isterminal = 1;
-      if (r->noswallow)
-	c->noswallow = 1;
-      if (r->isfloating)
-	c->isfloating = 1;
-      if (r->noroundcorners)
-	c->hasroundcorners = 0;
-      if (r->noanimatemove)
-	c->animate = 0;
-      if (r->noanimateresize)
-	c->animateresize = 0;
-      if (r->overrideresizehints != 0)
-	c->useresizehints = r->overrideresizehints == -1 ? 0 : 1;
-
-      c->tags |= r->tags;
-      for (m = mons; m && (m->tagset[m->seltags] & c->tags) == 0; m = m->next)
-	;
-      if (m)
-	c->mon = m;
-      if (r->lt)
-	newLayout = r->lt;
-    }
+  class = class ? class : broken;
+  instance = instance ? instance : broken;
+
+  /* all rules whose strings are contained in the ones of the client, in the
+   * order of rules[] */
+  matched = rules_match(c->cold->name, class, instance, &nmatched);
+  for (j = 0; j < nmatched; j++) {
+    r = &rules[matched[j]];
+    if (r->isterminal)
+      c->cold->isterminal = 1;
+    if (r->noswallow)
+      c->cold->noswallow = 1;
+    if (r->isfloating)
+      c->isfloating = 1;
+    if (r->noroundcorners)
+      c->hasroundcorners = 0;
+    if (r->noanimatemove)
+      c->animate = 0;
+    if (r->noanimateresize)
+      c->animateresize = 0;
+    if (r->overrideresizehints != 0)
+      c->useresizehints = r->overrideresizehints == -1 ? 0 : 1;
+
+    c->tags |= r->tags;
+    for (m = mons; m && (m->tagset[m->seltags] & c->tags) == 0; m = m->next)
+      ;
+    if (m)
+      c->mon = m;
+    if (r->lt)
+      newLayout = r->lt;
   }
-  if (ch.res_class)
-    XFree(ch.res_class);
-  if (ch.res_name)
-    XFree(ch.res_name);
 
   if (c->tags & TAGMASK) {
     c->tags = c->tags & TAGMASK;
@@ -336,36 +530,98 @@ int applysizehints(Client *c, int *x, int *y, int *w, int *h, int interact) {
   return *x != c->x || *y != c->y || *w != c->w || *h != c->h;
 }
 
+/* Only marks the monitor (or all monitors, if m is NULL) for rearrangement.
+ * The actual work is done once per event batch by arrangepending(). */
 void arrange(Monitor *m) {
+  tiledgen++;
   if (m)
-    showhide(m->cl->stack);
+    m->needarrange |= ArrangeLayout | ArrangeStack;
   else
     for (m = mons; m; m = m->next)
-      showhide(m->cl->stack);
-  if (m) {
-    arrangemon(m);
-    restack(m);
-  } else
-    for (m = mons; m; m = m->next)
+      m->needarrange |= ArrangeLayout;
+}
+
+void arrangepending(void) {
+  Monitor *m;
+  unsigned int pending = 0;
+  uint64_t t;
+
+  for (m = mons; m; m = m->next)
+    pending |= m->needarrange;
+  if (!pending) {
+    flushconfigures();
+    return;
+  }
+  t = stats_now();
+  XSTATS_PUSH(XCtxArrange);
+
+  /* configures queued so far use the on screen position, they must not move
+   * the clients showhide() hides back into view */
+  flushconfigures();
+  /* all monitors share the same client list */
+  showhide(cl->stack);
+  for (m = mons; m; m = m->next)
+    if (m->needarrange & ArrangeLayout)
       arrangemon(m);
+  flushconfigures();
+  for (m = mons; m; m = m->next) {
+    pending = m->needarrange;
+    m->needarrange = 0;
+    if (pending & ArrangeStack)
+      restack(m);
+  }
+  XFlush(dpy);
+  XSTATS_POP();
+  stats_add(arrangestat, t);
+}
+
+/* Moves the tiled clients c into the cells r computed by their layout, inside
+ * the gaps and borders. Clients that are already there, or on their way, are
+ * left alone. The configures are sent together by arrangepending(). */
+void applylayout(Client **c, const Rect *r, unsigned int n) {
+  unsigned int i;
+  int x, y, w, h;
+
+  for (i = 0; i < n; i++) {
+    x = r[i].x + gappx;
+    y = r[i].y + gappx;
+    w = r[i].w - 2 * c[i]->bw - 2 * gappx;
+    h = r[i].h - 2 * c[i]->bw - 2 * gappx;
+    if (x == c[i]->goalx && y == c[i]->goaly && w == c[i]->goalw &&
+	h == c[i]->goalh &&
+	((x == c[i]->x && y == c[i]->y && w == c[i]->w && h == c[i]->h) ||
+	 animateclient_find(c[i])))
+      continue;
+    resizegoal(c[i], x, y, w, h, 0, 1);
+  }
 }
 
 void arrangemon(Monitor *m) {
   strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, sizeof m->ltsymbol);
   if (m->lt[m->sellt]->arrange) {
     m->lt[m->sellt]->arrange(m);
-    animateclient_endall();
   }
 }
 
 void attach(Client *c) {
-  c->next = c->mon->cl->clients;
-  c->mon->cl->clients = c;
+  Clientlist *cl = c->mon->cl;
+
+  c->next = cl->clients;
+  c->prev = cl->clients ? cl->clients->prev : c;
+  if (cl->clients)
+    cl->clients->prev = c;
+  cl->clients = c;
+  tiledgen++;
 }
 
 void attachstack(Client *c) {
-  c->snext = c->mon->cl->stack;
-  c->mon->cl->stack = c;
+  Clientlist *cl = c->mon->cl;
+
+  c->snext = cl->stack;
+  c->sprev = cl->stack ? cl->stack->sprev : c;
+  if (cl->stack)
+    cl->stack->sprev = c;
+  cl->stack = c;
 }
 
 void attachclients(Monitor *m) {
@@ -393,6 +649,7 @@ void attachclients(Monitor *m) {
       unfocus(c, True);
       c->mon = m;
     }
+  tiledgen++;
 
   if (rmons)
     for (tm = mons; tm; tm = tm->next)
@@ -403,9 +660,9 @@ void attachclients(Monitor *m) {
 void swallow(Client *p, Client *c) {
   Client *s;
 
-  if (c->noswallow > 0 || c->isterminal)
+  if (c->cold->noswallow > 0 || c->cold->isterminal)
     return;
-  if (c->noswallow < 0 && !swallowfloating && c->isfloating)
+  if (c->cold->noswallow < 0 && !swallowfloating && c->isfloating)
     return;
 
   detach(c);
@@ -421,19 +678,30 @@ void swallow(Client *p, Client *c) {
   p->win = c->win;
   c->win = w;
 
+  winmap_del(&clientmap, w);
+  winmap_set(&clientmap, p->win, p);
+  winmap_set(&swallowmap, c->win, p);
+  p->shapew = c->shapew = 0; /* shapes belong to the old windows */
+
+  XSTAT(properties);
   XChangeProperty(dpy, c->win, netatom[NetClientList], XA_WINDOW, 32,
 		  PropModeReplace, (unsigned char *)&(p->win), 1);
+  clientlist_remove(w);
 
   updatetitle(p);
   s = scanner ? c : p;
   resizeclient(p, s->x, s->y, s->w, s->h);
-  updateclientlist();
 }
 
 void unswallow(Client *c) {
+  clientlist_replace(c->win, c->swallowing->win);
+  winmap_del(&clientmap, c->win);
+  winmap_del(&swallowmap, c->swallowing->win);
   c->win = c->swallowing->win;
+  winmap_set(&clientmap, c->win, c);
+  c->shapew = 0;
 
-  free(c->swallowing);
+  freeclient(c->swallowing);
   c->swallowing = NULL;
 
   XDeleteProperty(dpy, c->win, netatom[NetClientList]);
@@ -483,8 +751,10 @@ void checkotherwm(void) {
   xerrorxlib = XSetErrorHandler(xerrorstart);
   /* this causes an error if some other window manager is running */
   XSelectInput(dpy, DefaultRootWindow(dpy), SubstructureRedirectMask);
+  XSTAT(syncs);
   XSync(dpy, False);
   XSetErrorHandler(xerror);
+  XSTAT(syncs);
   XSync(dpy, False);
 }
 
@@ -495,34 +765,58 @@ void cleanup(void) {
   size_t i;
 
   view(&a);
+  arrangepending(); /* make all clients visible again */
+  animateclient_endall();
   selmon->lt[selmon->sellt] = &foo;
   for (m = mons; m; m = m->next)
     while (m->cl->stack)
       unmanage(m->cl->stack, 0);
   XUngrabKey(dpy, AnyKey, AnyModifier, root);
+  free(keybindings);
   while (mons)
     cleanupmon(mons);
+  winmap_free(&clientmap);
+  winmap_free(&swallowmap);
+  rules_free();
+  layouts_free();
+  pool_destroy(&clientpool);
+  pool_destroy(&coldpool);
+  stats_free();
+  free(querystats);
+  free(configqueue);
+  while (animations)
+    animateclient_cancel(animations->c);
+  close(animtimer.fd);
+  close(bartimer.fd);
+  proctree_free();
+  close(sigsource.fd);
+  close(epollfd);
+  for (i = 0; i < ncornertabs; i++)
+    free(cornertabs[i]);
+  free(cornertabs);
+  free(shaperects);
+  free(clientlist);
+  free(stackinglist);
   for (i = 0; i < CurLast; i++)
     drw_cur_free(drw, cursor[i]);
   for (i = 0; i < LENGTH(colors); i++)
     free(scheme[i]);
   XDestroyWindow(dpy, wmcheckwin);
   drw_free(drw);
+  XSTAT(syncs);
   XSync(dpy, False);
   XSetInputFocus(dpy, PointerRoot, RevertToPointerRoot, CurrentTime);
   XDeleteProperty(dpy, root, netatom[NetActiveWindow]);
 
   /* Close and remove socket.
    * Ignore Errors, since we are quitting dwm soon. */
-  if (pthread_cancel(querysocket_thread) != 0)
-    fprintf(stderr, "Could not Cancel Query Thread.\n");
-  if (pthread_join(querysocket_thread, NULL) != 0)
-    fprintf(stderr, "Could not Cancel Query Thread.\n");
-  if (shutdown(querysocket, SHUT_RDWR) != 0)
+  while (queryclients)
+    querysocket_close(queryclients);
+  if (shutdown(querysocket.fd, SHUT_RDWR) != 0)
     fprintf(stderr, "Could not shutdown socket.\n");
-  if (close(querysocket) != 0)
+  if (close(querysocket.fd) != 0)
     fprintf(stderr, "Could not close socket.\n");
-  if (unlink(SOCKET_PATH) != 0)
+  if (unlink(socketpath) != 0)
     fprintf(stderr, "Could not remove socket.\n");
 }
 
@@ -538,6 +832,7 @@ void cleanupmon(Monitor *mon) {
   }
   XUnmapWindow(dpy, mon->barwin);
   XDestroyWindow(dpy, mon->barwin);
+  free(mon->tiled);
   free(mon);
 }
 
@@ -655,7 +950,6 @@ void configurerequest(XEvent *e) {
     wc.stack_mode = ev->detail;
     XConfigureWindow(dpy, ev->window, ev->value_mask, &wc);
   }
-  XSync(dpy, False);
 }
 
 Monitor *createmon(void) {
@@ -709,19 +1003,33 @@ void destroynotify(XEvent *e) {
 }
 
 void detach(Client *c) {
-  Client **tc;
+  Clientlist *cl = c->mon->cl;
 
-  for (tc = &c->mon->cl->clients; *tc && *tc != c; tc = &(*tc)->next)
-    ;
-  *tc = c->next;
+  if (c == cl->clients)
+    cl->clients = c->next;
+  else
+    c->prev->next = c->next;
+  if (c->next)
+    c->next->prev = c->prev;
+  else if (cl->clients)
+    cl->clients->prev = c->prev;
+  c->next = c->prev = NULL;
+  tiledgen++;
 }
 
 void detachstack(Client *c) {
-  Client **tc, *t;
+  Clientlist *cl = c->mon->cl;
+  Client *t;
 
-  for (tc = &c->mon->cl->stack; *tc && *tc != c; tc = &(*tc)->snext)
-    ;
-  *tc = c->snext;
+  if (c == cl->stack)
+    cl->stack = c->snext;
+  else
+    c->sprev->snext = c->snext;
+  if (c->snext)
+    c->snext->sprev = c->sprev;
+  else if (cl->stack)
+    cl->stack->sprev = c->sprev;
+  c->snext = c->sprev = NULL;
 
   if (c == c->mon->sel) {
     for (t = c->mon->cl->stack; t && !ISVISIBLE(t, c->mon); t = t->snext)
@@ -769,6 +1077,9 @@ void enternotify(XEvent *e) {
 }
 
 void focus(Client *c) {
+  uint64_t t = stats_now();
+
+  XSTATS_PUSH(XCtxFocus);
   if (!c || !ISVISIBLE(c, selmon))
     for (c = selmon->cl->stack; c && !ISVISIBLE(c, selmon); c = c->snext)
       ;
@@ -789,6 +1100,9 @@ void focus(Client *c) {
     XDeleteProperty(dpy, root, netatom[NetActiveWindow]);
   }
   selmon->sel = c;
+  querysocket_mark(SubFocus);
+  XSTATS_POP();
+  stats_add(focusstat, t);
 }
 
 /* there are some broken focus acquiring clients needing extra handling */
@@ -813,7 +1127,7 @@ void focusmon(const Arg *arg) {
 }
 
 void focusstack(const Arg *arg) {
-  Client *c = NULL, *i;
+  Client *c = NULL;
 
   if (!selmon->sel)
     return;
@@ -824,13 +1138,10 @@ void focusstack(const Arg *arg) {
       for (c = selmon->cl->clients; c && !ISVISIBLE(c, selmon); c = c->next)
 	;
   } else {
-    for (i = selmon->cl->clients; i != selmon->sel; i = i->next)
-      if (ISVISIBLE(i, selmon))
-	c = i;
-    if (!c)
-      for (; i; i = i->next)
-	if (ISVISIBLE(i, selmon))
-	  c = i;
+    /* prev wraps around from the first to the last client */
+    for (c = selmon->sel->prev; c != selmon->sel && !ISVISIBLE(c, selmon);
+	 c = c->prev)
+      ;
   }
   if (c) {
     focus(c);
@@ -844,6 +1155,7 @@ Atom getatomprop(Client *c, Atom prop, int num) {
   unsigned char *p = NULL;
   Atom da, atom = None;
 
+  XSTAT(replies);
   if (XGetWindowProperty(dpy, c->win, prop, 0L, sizeof atom, False, XA_ATOM,
 			 &da, &di, &dl1, &dl2, &p) == Success &&
       p) {
@@ -860,6 +1172,7 @@ int getrootptr(int *x, int *y) {
   unsigned int dui;
   Window dummy;
 
+  XSTAT(replies);
   return XQueryPointer(dpy, root, &dummy, &dummy, x, y, &di, &di, &dui);
 }
 
@@ -870,6 +1183,7 @@ long getstate(Window w) {
   unsigned long n, extra;
   Atom real;
 
+  XSTAT(replies);
   if (XGetWindowProperty(dpy, w, wmatom[WMState], 0L, 2L, False,
 			 wmatom[WMState], &real, &format, &n, &extra,
 			 (unsigned char **)&p) != Success)
@@ -881,27 +1195,34 @@ long getstate(Window w) {
 }
 
 int gettextprop(Window w, Atom atom, char *text, unsigned int size) {
-  char **list = NULL;
-  int n;
   XTextProperty name;
 
   if (!text || size == 0)
     return 0;
   text[0] = '\0';
+  XSTAT(replies);
   if (!XGetTextProperty(dpy, w, &name, atom) || !name.nitems)
     return 0;
-  if (name.encoding == XA_STRING)
-    strncpy(text, (char *)name.value, size - 1);
+  textproptostr(&name, text, size);
+  XFree(name.value);
+  return 1;
+}
+
+/* name->value has to be null terminated, like Xlib does it. */
+void textproptostr(XTextProperty *name, char *text, unsigned int size) {
+  char **list = NULL;
+  int n;
+
+  if (name->encoding == XA_STRING)
+    strncpy(text, (char *)name->value, size - 1);
   else {
-    if (XmbTextPropertyToTextList(dpy, &name, &list, &n) >= Success && n > 0 &&
+    if (XmbTextPropertyToTextList(dpy, name, &list, &n) >= Success && n > 0 &&
 	*list) {
       strncpy(text, *list, size - 1);
       XFreeStringList(list);
     }
   }
   text[size - 1] = '\0';
-  XFree(name.value);
-  return 1;
 }
 
 void grabbuttons(Client *c, int focused) {
@@ -923,31 +1244,58 @@ void grabbuttons(Client *c, int focused) {
   }
 }
 
+/* Builds the keycode -> key binding table from the current keyboard mapping,
+ * a keycode is bound to the keys of its first keysym. Only the bound
+ * keycodes are grabbed. */
 void grabkeys(void) {
   updatenumlockmask();
   {
-    unsigned int i, j;
+    unsigned int i, j, n;
     unsigned int modifiers[] = {0, LockMask, numlockmask,
 				numlockmask | LockMask};
-    KeyCode code;
+    int start, end, skip, k;
+    KeySym *syms;
 
     XUngrabKey(dpy, AnyKey, AnyModifier, root);
-    for (i = 0; i < keys_size; i++)
-      if ((code = XKeysymToKeycode(dpy, keys[i].keysym)))
-	for (j = 0; j < LENGTH(modifiers); j++)
-	  XGrabKey(dpy, code, keys[i].mod | modifiers[j], root, True,
-		   GrabModeAsync, GrabModeAsync);
+    memset(keystart, 0, sizeof(keystart));
+    XDisplayKeycodes(dpy, &start, &end);
+    if (!(syms = XGetKeyboardMapping(dpy, start, end - start + 1, &skip)))
+      return;
+
+    /* count the bindings of every keycode first, then fill them in */
+    for (n = 0, k = start; k <= end; k++)
+      for (i = 0; i < keys_size; i++)
+	if (keys[i].keysym == syms[(k - start) * skip])
+	  n++;
+    if (n > nkeybindings) {
+      free(keybindings);
+      keybindings = ecalloc(n, sizeof(KeyBinding));
+    }
+    nkeybindings = n;
+    for (n = 0, k = 0; k < LENGTH(keystart) - 1; k++) {
+      keystart[k] = n;
+      if (k < start || k > end)
+	continue;
+      for (i = 0; i < keys_size; i++)
+	if (keys[i].keysym == syms[(k - start) * skip]) {
+	  keybindings[n].mod = CLEANMASK(keys[i].mod);
+	  keybindings[n++].key = &keys[i];
+	  for (j = 0; j < LENGTH(modifiers); j++)
+	    XGrabKey(dpy, k, keys[i].mod | modifiers[j], root, True,
+		     GrabModeAsync, GrabModeAsync);
+	}
+    }
+    keystart[k] = n;
+    XFree(syms);
   }
 }
 
 void incnmaster(const Arg *arg) {
-  unsigned int i;
+  unsigned int i, ntiled;
   int n;
-  Client *c;
 
-  for (n = 0, c = nexttiled(selmon->cl->clients, selmon); c;
-       c = nexttiled(c->next, selmon), n++)
-    ;
+  tiledclients(selmon, &ntiled);
+  n = ntiled;
 
   if (arg->i == 0)
     selmon->nmaster = nmaster;
@@ -976,66 +1324,121 @@ static int isuniquegeom(XineramaScreenInfo *unique, size_t n,
 #endif /* XINERAMA */
 
 void keypress(XEvent *e) {
-  unsigned int i;
-  KeySym keysym;
+  unsigned int i, mod;
   XKeyEvent *ev;
 
   ev = &e->xkey;
-  keysym = XKeycodeToKeysym(dpy, (KeyCode)ev->keycode, 0);
-  for (i = 0; i < keys_size; i++)
-    if (keysym == keys[i].keysym &&
-	CLEANMASK(keys[i].mod) == CLEANMASK(ev->state) && keys[i].func)
-      keys[i].func(&(keys[i].arg));
+  mod = CLEANMASK(ev->state);
+  for (i = keystart[ev->keycode & 0xff]; i < keystart[(ev->keycode & 0xff) + 1];
+       i++)
+    if (keybindings[i].mod == mod && keybindings[i].key->func)
+      keybindings[i].key->func(&(keybindings[i].key->arg));
 }
 
+/* Handles "fsignal:<signame> [<type> <value>]" in the name of the root window,
+ * with type i, ui or f. */
 int fake_signal(void) {
   char fsignal[256];
-  char indicator[9] = "fsignal:";
-  char str_sig[50];
-  char param[16];
-  int i, len_str_sig, n, paramn;
-  size_t len_fsignal, len_indicator = strlen(indicator);
-  Arg arg;
-
-  // Get root name property
-  if (gettextprop(root, XA_WM_NAME, fsignal, sizeof(fsignal))) {
-    len_fsignal = strlen(fsignal);
-
-    // Check if this is indeed a fake signal
-    if (len_indicator > len_fsignal
-	    ? 0
-	    : strncmp(indicator, fsignal, len_indicator) == 0) {
-      paramn = sscanf(fsignal + len_indicator, "%s%n%s%n", str_sig,
-		      &len_str_sig, param, &n);
-
-      if (paramn == 1)
-	arg = (Arg){0};
-      else if (paramn > 2)
-	return 1;
-      else if (strncmp(param, "i", n - len_str_sig) == 0)
-	sscanf(fsignal + len_indicator + n, "%i", &(arg.i));
-      else if (strncmp(param, "ui", n - len_str_sig) == 0)
-	sscanf(fsignal + len_indicator + n, "%u", &(arg.ui));
-      else if (strncmp(param, "f", n - len_str_sig) == 0)
-	sscanf(fsignal + len_indicator + n, "%f", &(arg.f));
-      else
-	return 1;
-
-      // Check if a signal was found, and if so handle it
-      for (i = 0; i < signals_size; i++)
-	if (strncmp(str_sig, signals[i].sig, len_str_sig) == 0 &&
-	    signals[i].func) {
-	  signals[i].func(&(arg));
-	  return 1;
-	}
 
-      // A fake signal was sent
-      return 1;
-    }
+  if (!getfsignal(fsignal, sizeof(fsignal)))
+    return 0; /* No fake signal was sent, so proceed with update */
+  runsignal(fsignal);
+  return 1;
+}
+
+/* Runs "<signame> [<type> <value>]", returns 0 if there is no such signal. */
+int runsignal(char *s) {
+  char *p, *name, *type, *end;
+  size_t namelen, typelen;
+  const Signal *sig;
+  Arg arg = {0};
+
+  for (p = s; *p == ' '; p++)
+    ;
+  for (name = p; *p && *p != ' '; p++)
+    ;
+  namelen = p - name;
+  for (; *p == ' '; p++)
+    ;
+  for (type = p; *p && *p != ' '; p++)
+    ;
+  typelen = p - type;
+
+  if (typelen == 1 && type[0] == 'i')
+    arg.i = strtol(p, &end, 0);
+  else if (typelen == 2 && type[0] == 'u' && type[1] == 'i')
+    arg.ui = strtoul(p, &end, 10);
+  else if (typelen == 1 && type[0] == 'f')
+    arg.f = strtof(p, &end);
+  else if (typelen)
+    return 0;
+  if (typelen) {
+    /* reject a missing or malformed value instead of running with 0 */
+    if (end == p)
+      return 0;
+    for (; *end == ' '; end++)
+      ;
+    if (*end)
+      return 0;
   }
 
-  // No fake signal was sent, so proceed with update
-  return 0;
+  if (!(sig = findsignal(name, namelen)) || !sig->func)
+    return 0;
+  sig->func(&arg);
+  return 1;
+}
+
+/* Reads the root window name into text, if it starts with "fsignal:".
+ * Only the two longs of the prefix are fetched first, so status texts cost
+ * no more than that. */
+int getfsignal(char *text, unsigned int size) {
+  Atom type;
+  int format, match;
+  unsigned long n, after;
+  unsigned char *data = NULL;
+
+  XSTAT(replies);
+  if (XGetWindowProperty(dpy, root, XA_WM_NAME, 0, 2, False, AnyPropertyType,
+			 &type, &format, &n, &after, &data) != Success ||
+      !data)
+    return 0;
+  match = format == 8 && n == 8 && !memcmp(data, "fsignal:", 8);
+  XFree(data);
+  if (!match)
+    return 0;
+
+  text[0] = '\0';
+  if (!after)
+    return 1;
+  XSTAT(replies);
+  if (XGetWindowProperty(dpy, root, XA_WM_NAME, 2, (size - 1) / 4, False,
+			 AnyPropertyType, &type, &format, &n, &after,
+			 &data) == Success &&
+      data) {
+    n = MIN(n, size - 1);
+    memcpy(text, data, n);
+    text[n] = '\0';
+    XFree(data);
+  }
+  return 1;
+}
+
+/* Must compute the same hash as sighash.awk. */
+unsigned int sighash(const char *s, size_t len) {
+  unsigned long h = 0;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    h = (h * SIGHASH_MULT + (unsigned char)s[i]) % 1000003;
+  return h % SIGHASH_SIZE;
+}
+
+const Signal *findsignal(const char *name, size_t len) {
+  unsigned int i = sighash_index[sighash(name, len)];
+
+  if (!i || strncmp(signals[i - 1].sig, name, len) || signals[i - 1].sig[len])
+    return NULL;
+  return &signals[i - 1];
 }
 
 void killclient(const Arg *arg) {
@@ -1043,12 +1446,15 @@ void killclient(const Arg *arg) {
     return;
   if (!sendevent(selmon->sel, wmatom[WMDelete])) {
     XGrabServer(dpy);
+    XSTATS_GRAB();
     XSetErrorHandler(xerrordummy);
     XSetCloseDownMode(dpy, DestroyAll);
     XKillClient(dpy, selmon->sel->win);
+    XSTAT(syncs);
     XSync(dpy, False);
     XSetErrorHandler(xerror);
     XUngrabServer(dpy);
+    XSTATS_UNGRAB();
   }
 }
 
@@ -1081,10 +1487,24 @@ void manage(Window w, XWindowAttributes *wa) {
   Client *c, *t = NULL, *term = NULL;
   Window trans = None;
   XWindowChanges wc;
-
-  c = ecalloc(1, sizeof(Client));
+  PropCookies ck;
+  xcb_get_property_reply_t *r;
+  XSizeHints size;
+  XWMHints wmh;
+  int haswmh;
+  Atom state[2] = {None, None}, wtype = None;
+  char class[256], instance[256];
+  int hasclass;
+  uint64_t start = stats_now();
+
+  /* Send all requests first and only then wait for the replies, so that
+   * managing a window costs a single round trip. */
+  sendprops(w, &ck);
+
+  c = newclient();
   c->win = w;
-  c->pid = winpid(w);
+  c->cold->pid = recvpid(ck.pid);
+  launch_mapped(c->cold->pid);
   /* geometry */
   c->x = c->oldx = wa->x;
   c->y = c->oldy = wa->y;
@@ -1092,13 +1512,36 @@ void manage(Window w, XWindowAttributes *wa) {
   c->h = c->oldh = wa->height;
   c->oldbw = wa->border_width;
 
-  updatetitle(c);
-  if (XGetTransientForHint(dpy, w, &trans) && (t = wintoclient(trans))) {
+  if (!recvtextprop(ck.netwmname, c->cold->name, sizeof c->cold->name))
+    recvtextprop(ck.wmname, c->cold->name, sizeof c->cold->name);
+  if (c->cold->name[0] == '\0') /* hack to mark broken clients */
+    strcpy(c->cold->name, broken);
+  if ((r = recvprop(ck.trans, XA_WINDOW, 32))) {
+    trans = *(uint32_t *)xcb_get_property_value(r);
+    free(r);
+  }
+  hasclass = recvclass(ck.class, class, instance, sizeof class);
+  if ((r = recvprop(ck.state, XA_ATOM, 32))) {
+    state[0] = ((uint32_t *)xcb_get_property_value(r))[0];
+    if (xcb_get_property_value_length(r) >= 2 * 4)
+      state[1] = ((uint32_t *)xcb_get_property_value(r))[1];
+    free(r);
+  }
+  if ((r = recvprop(ck.wtype, XA_ATOM, 32))) {
+    wtype = *(uint32_t *)xcb_get_property_value(r);
+    free(r);
+  }
+  if (!recvsizehints(ck.normalhints, &size))
+    /* size is uninitialized, ensure that size.flags aren't used */
+    size.flags = PSize;
+  haswmh = recvwmhints(ck.hints, &wmh);
+
+  if (trans != None && (t = wintoclient(trans))) {
     c->mon = t->mon;
     c->tags = t->tags;
   } else {
     c->mon = selmon;
-    applyrules(c);
+    applyrules(c, hasclass ? class : NULL, hasclass ? instance : NULL);
     term = termforwin(c);
   }
 
@@ -1121,9 +1564,10 @@ void manage(Window w, XWindowAttributes *wa) {
   XConfigureWindow(dpy, w, CWBorderWidth, &wc);
   XSetWindowBorder(dpy, w, scheme[SchemeNorm][ColBorder].pixel);
   configure(c); /* propagates border_width, if size doesn't change */
-  updatewindowtype(c);
-  updatesizehints(c);
-  updatewmhints(c);
+  setwindowtype(c, state[0], state[1], wtype);
+  setsizehints(c, &size);
+  if (haswmh)
+    setwmhints(c, &wmh);
   XSelectInput(dpy, w,
 	       EnterWindowMask | FocusChangeMask | PropertyChangeMask |
 		   StructureNotifyMask);
@@ -1134,8 +1578,8 @@ void manage(Window w, XWindowAttributes *wa) {
     XRaiseWindow(dpy, c->win);
   attach(c);
   attachstack(c);
-  XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32,
-		  PropModeAppend, (unsigned char *)&(c->win), 1);
+  winmap_set(&clientmap, c->win, c);
+  clientlist_add(c->win);
   XMoveResizeWindow(dpy, c->win, c->x + 2 * sw, c->y, c->w,
 		    c->h); /* some windows require this */
   setclientstate(c, NormalState);
@@ -1155,7 +1599,9 @@ void manage(Window w, XWindowAttributes *wa) {
 
   XMapWindow(dpy, tw); /* Make the window visible */
   focus(NULL);
-  spawnbarupdate();
+  querysocket_mark(SubOcc | SubUrg | SubFocus);
+  barupdate();
+  stats_add(managestat, start);
 }
 
 void mappingnotify(XEvent *e) {
@@ -1170,6 +1616,7 @@ void maprequest(XEvent *e) {
   static XWindowAttributes wa;
   XMapRequestEvent *ev = &e->xmaprequest;
 
+  XSTAT(replies);
   if (!XGetWindowAttributes(dpy, ev->window, &wa))
     return;
   if (wa.override_redirect)
@@ -1243,6 +1690,7 @@ void movemouse(const Arg *arg) {
 	resize(c, nx, ny, c->w, c->h, 1, 0);
       break;
     }
+    arrangepending();
   } while (ev.type != ButtonRelease);
   XUngrabPointer(dpy, CurrentTime);
   if ((m = recttomon(c->x, c->y, c->w, c->h)) != selmon) {
@@ -1252,12 +1700,50 @@ void movemouse(const Arg *arg) {
   }
 }
 
+Client *newclient(void) {
+  Client *c = pool_alloc(&clientpool);
+
+  c->cold = pool_alloc(&coldpool);
+  return c;
+}
+
+/* Also forgets the pending configure and animation of the client. */
+void freeclient(Client *c) {
+  unqueueconfigure(c);
+  animateclient_cancel(c);
+  pool_free(&coldpool, c->cold);
+  pool_free(&clientpool, c);
+}
+
 Client *nexttiled(Client *c, Monitor *m) {
   for (; c && (c->isfloating || !ISVISIBLE(c, m)); c = c->next)
     ;
   return c;
 }
 
+/* Returns the visible tiled clients of m in the order of the client list.
+ * The array is only rebuilt after tiledgen was bumped, by arrange() or by a
+ * change of the client list. */
+Client **tiledclients(Monitor *m, unsigned int *n) {
+  Client *c;
+
+  if (m->tiledgen != tiledgen) {
+    m->ntiled = 0;
+    for (c = nexttiled(m->cl->clients, m); c; c = nexttiled(c->next, m)) {
+      if (m->ntiled == m->tiledsize) {
+	m->tiledsize = m->tiledsize ? 2 * m->tiledsize : 32;
+	if (!(m->tiled = realloc(m->tiled, m->tiledsize * sizeof(Client *))))
+	  die("fatal: could not realloc() %u bytes\n",
+	      m->tiledsize * sizeof(Client *));
+      }
+      m->tiled[m->ntiled++] = c;
+    }
+    m->tiledgen = tiledgen;
+  }
+  *n = m->ntiled;
+  return m->tiled;
+}
+
 void overview(const Arg *arg) {
   if (overviewmode == 0 && selmon->tagset[selmon->seltags] != TAGMASK) {
     if (overviewlayout)
@@ -1283,16 +1769,19 @@ void propertynotify(XEvent *e) {
   Window trans;
   XPropertyEvent *ev = &e->xproperty;
 
-  if ((ev->window == root) && (ev->atom == XA_WM_NAME)) {
-    fake_signal();
-  } else if (ev->state == PropertyDelete)
+  if (ev->state == PropertyDelete)
     return; /* ignore */
-  else if ((c = wintoclient(ev->window))) {
+  else if ((ev->window == root) && (ev->atom == XA_WM_NAME)) {
+    fake_signal();
+  } else if ((c = wintoclient(ev->window))) {
     switch (ev->atom) {
     default:
       break;
     case XA_WM_TRANSIENT_FOR:
-      if (!c->isfloating && (XGetTransientForHint(dpy, c->win, &trans)) &&
+      if (c->isfloating)
+	break;
+      XSTAT(replies);
+      if (XGetTransientForHint(dpy, c->win, &trans) &&
 	  (c->isfloating = (wintoclient(trans)) != NULL))
 	arrange(c->mon);
       break;
@@ -1317,59 +1806,341 @@ void quit(const Arg *arg) {
     running = 0;
 }
 
-void *querysocket_listen(void *arg) {
-  pthread_t thread;
-  int socketfd;
-  int *socketfd_arg;
+void querysocket_accept(EventSource *src, unsigned int events) {
+  QueryClient *q;
+  int fd;
 
-  while (running) { /* Wait for socket connections and handle them. */
-    if ((socketfd = accept(querysocket, NULL, NULL)) == -1) {
-      fprintf(stderr, "Could not connect to new socket. Errno: %d\n", errno);
-      continue;
+  if ((fd = accept4(src->fd, NULL, NULL, SOCK_CLOEXEC)) == -1) {
+    fprintf(stderr, "Could not connect to new socket. Errno: %d\n", errno);
+    return;
+  }
+  q = ecalloc(1, sizeof(QueryClient));
+  q->src.fd = fd;
+  q->src.handle = querysocket_handle;
+  if (!watchfd(&q->src, EPOLLIN)) {
+    fprintf(stderr, "Could not watch new socket. Errno: %d\n", errno);
+    close(fd);
+    free(q);
+    return;
+  }
+  q->next = queryclients;
+  queryclients = q;
+}
+
+void querysocket_handle(EventSource *src, unsigned int events) {
+  QueryClient *q = (QueryClient *)src;
+
+  if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+    querysocket_read(q);
+  else
+    querysocket_flush(q);
+}
+
+/* Reads everything the peer sent so far without blocking and executes all
+ * complete requests, their responses are sent together afterwards. */
+void querysocket_read(QueryClient *q) {
+  ssize_t n;
+  uint32_t len;
+  unsigned int off = 0;
+
+  while ((n = recv(q->src.fd, q->in + q->inlen, sizeof(q->in) - q->inlen,
+		   MSG_DONTWAIT)) > 0)
+    if ((q->inlen += n) == sizeof(q->in))
+      break;
+  if (n == 0 || (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK &&
+		 errno != EINTR))
+    q->closing = 1;
+
+  /* Requests of the old protocol start with a function name of at least two
+   * characters, which reads as a length above MAXBUFF_QUERY. */
+  if (!q->framed && !q->legacy && q->inlen >= sizeof(len)) {
+    memcpy(&len, q->in, sizeof(len));
+    if (len > MAXBUFF_QUERY)
+      q->legacy = 1;
+    else
+      q->framed = 1;
+  }
+
+  if (q->legacy) {
+    if (q->inlen >= MAXBUFF_SOCKET || (q->closing && q->inlen)) {
+      q->in[MIN(q->inlen, MAXBUFF_SOCKET - 1)] = '\0';
+      querysocket_respond(q, 0, q->in);
+      q->inlen = 0;
+      q->closing = 1; /* one request per connection */
+    }
+  } else {
+    while (q->inlen - off >= sizeof(len)) {
+      memcpy(&len, q->in + off, sizeof(len));
+      if (len < sizeof(uint32_t) || len > MAXBUFF_QUERY) {
+	fprintf(stderr, "Invalid query of length %u.\n", len);
+	querysocket_close(q);
+	return;
+      }
+      if (q->inlen - off < sizeof(len) + len)
+	break;
+      querysocket_respond(q, off + sizeof(len), NULL);
+      off += sizeof(len) + len;
     }
+    memmove(q->in, q->in + off, q->inlen - off);
+    q->inlen -= off;
+  }
 
-    /* Save File Descriptor on Heap, to savely bring it to the new thread. */
-    if ((socketfd_arg = malloc(sizeof(socketfd_arg))) == NULL) {
-      fprintf(stderr, "Could not malloc Query Argument. Errno: %d\n", errno);
-      continue;
+  querysocket_flush(q);
+}
+
+/* Executes the request at off in the input buffer and appends its response
+ * to the output buffer. A legacy request is passed as a string instead. */
+void querysocket_respond(QueryClient *q, unsigned int off, char *legacy) {
+  char input[MAXBUFF_QUERY];
+  char output[MAXBUFF_QUERY];
+  uint32_t len, id;
+  int32_t res;
+  int subscribe;
+
+  memset(output, '\0', MAXBUFF_SOCKET);
+  if (legacy) {
+    res = querysocket_execute(legacy, output);
+    output[MAXBUFF_SOCKET - 1] = '\0';
+    querysocket_append(q, &res, sizeof(res));
+    querysocket_append(q, output, MAXBUFF_SOCKET);
+    return;
+  }
+
+  memcpy(&len, q->in + off - sizeof(len), sizeof(len));
+  memcpy(&id, q->in + off, sizeof(id));
+  len -= sizeof(id);
+  memcpy(input, q->in + off + sizeof(id), len);
+  input[MIN(len, MAXBUFF_QUERY - 1)] = '\0';
+  subscribe = strncmp(input, "subscribe", 9) == 0 &&
+	      (input[9] == '\0' || input[9] == ' ');
+  if (subscribe)
+    res = querysocket_subscribe(q, input + 9, output);
+  else
+    res = querysocket_execute(input, output);
+
+  len = sizeof(id) + sizeof(res) + strlen(output);
+  querysocket_append(q, &len, sizeof(len));
+  querysocket_append(q, &id, sizeof(id));
+  querysocket_append(q, &res, sizeof(res));
+  querysocket_append(q, output, strlen(output));
+  if (subscribe && res == 0)
+    querysocket_sendstate(q, q->subscribed);
+}
+
+/* Subscribes the connection to the events named in the arguments, or to all
+ * of them. The current state is sent after the response, changes follow as
+ * events with the id SUBSCRIBE_EVENTID. */
+int querysocket_subscribe(QueryClient *q, char *args, char *output) {
+  static const char *names[] = {"tags", "focus", "layout", "occ", "urg",
+				"monitors"};
+  unsigned int i, mask = 0;
+  char *tok;
+
+  for (tok = strtok(args, " "); tok; tok = strtok(NULL, " ")) {
+    for (i = 0; i < LENGTH(names) && strcmp(tok, names[i]); i++)
+      ;
+    if (i == LENGTH(names)) {
+      snprintf(output, MAXBUFF_SOCKET, "Unknown event %s.", tok);
+      return 1;
     }
-    *socketfd_arg = socketfd;
+    mask |= 1 << i;
+  }
+  q->subscribed = mask ? mask : SubAll;
+  strcpy(output, "subscribed");
+  return 0;
+}
 
-    if (pthread_create(&thread, NULL, querysocket_execute, socketfd_arg) != 0) {
-      fprintf(stderr, "Could not create Query Execution Thread. Errno: %d\n",
-	      errno);
-      close(socketfd);
-      free(socketfd_arg);
+/* Remembers that some published state may have changed, it is compared and
+ * sent to subscribers once at the end of the event batch. */
+void querysocket_mark(unsigned int events) { subpending |= events; }
+
+/* Sends an event to every connection subscribed to it, or only to q. When
+ * sending to all, subscribers with too much output pending are closed. */
+void querysocket_event(QueryClient *q, unsigned int event, const char *fmt,
+		       ...) {
+  char output[MAXBUFF_SOCKET];
+  uint32_t len, id = SUBSCRIBE_EVENTID;
+  int32_t res = 0;
+  va_list ap;
+  QueryClient *r, *next;
+
+  va_start(ap, fmt);
+  vsnprintf(output, sizeof(output), fmt, ap);
+  va_end(ap);
+  len = sizeof(id) + sizeof(res) + strlen(output);
+  for (r = q ? q : queryclients; r; r = next) {
+    next = q ? NULL : r->next;
+    if (!(r->subscribed & event))
+      continue;
+    if (!q && r->outlen + sizeof(len) + len > MAXBUFF_SUBSCRIBER) {
+      querysocket_close(r);
       continue;
     }
-    pthread_detach(thread);
+    querysocket_append(r, &len, sizeof(len));
+    querysocket_append(r, &id, sizeof(id));
+    querysocket_append(r, &res, sizeof(res));
+    querysocket_append(r, output, strlen(output));
   }
+}
 
-  return NULL;
+void tagstostr(unsigned int tags, char *s) {
+  int i;
+
+  for (i = 0; i < TAGSLENGTH; i++)
+    s[i] = tags & (1 << i) ? '1' : '0';
+  s[i] = '\0';
 }
 
-void *querysocket_execute(void *arg) {
-  int fd = *((int *)arg);
-  free(arg);
+/* Sends the complete current state of the given events to q. */
+void querysocket_sendstate(QueryClient *q, unsigned int events) {
+  char tags[TAGSLENGTH + 1];
+  unsigned int occ = 0, urg = 0;
+  int i;
+  Monitor *m;
+  Client *c;
 
-  int i, used;
-  int res = 1;
-  int (*qfunc)(char *, char *) = NULL;
-  char inputBuf[MAXBUFF_SOCKET];
-  char outputBuf[MAXBUFF_SOCKET];
-  char funcname[MAXBUFF_SOCKET];
+  for (c = cl->clients; c; c = c->next) {
+    occ |= c->tags;
+    if (c->isurgent)
+      urg |= c->tags;
+  }
+  for (i = 0, m = mons; m; m = m->next, i++) {
+    tagstostr(m->tagset[m->seltags], tags);
+    if (events & SubTags)
+      querysocket_event(q, SubTags, "tags %d %s", i, tags);
+    if (events & SubLayout)
+      querysocket_event(q, SubLayout, "layout %d %s", i, m->ltsymbol);
+  }
+  if (events & SubMons)
+    querysocket_event(q, SubMons, "monitors %d", i);
+  if (events & SubFocus)
+    querysocket_event(q, SubFocus, "focus 0x%lx",
+		      selmon->sel ? selmon->sel->win : 0);
+  tagstostr(occ, tags);
+  if (events & SubOcc)
+    querysocket_event(q, SubOcc, "occ %s", tags);
+  tagstostr(urg, tags);
+  if (events & SubUrg)
+    querysocket_event(q, SubUrg, "urg %s", tags);
+}
 
-  memset(outputBuf, '\0', MAXBUFF_SOCKET);
+/* Compares everything marked since the last call with the state that was
+ * published last, and sends the differences to all subscribers. */
+void querysocket_publish(void) {
+  char tags[TAGSLENGTH + 1];
+  unsigned int occ = 0, urg = 0;
+  int i;
+  Monitor *m;
+  Client *c;
+  Window sel;
+  QueryClient *q, *next;
 
-  if (recv(fd, inputBuf, sizeof(inputBuf), 0) <= 0) {
-    strncpy(outputBuf, "Did not recieve any bytes.", MAXBUFF_SOCKET);
-    goto QueryEnd;
+  if (!subpending)
+    return;
+  if (subpending & (SubOcc | SubUrg))
+    for (c = cl->clients; c; c = c->next) {
+      occ |= c->tags;
+      if (c->isurgent)
+	urg |= c->tags;
+    }
+  for (i = 0, m = mons; m; m = m->next, i++) {
+    if ((subpending & SubTags) && m->pubtags != m->tagset[m->seltags]) {
+      m->pubtags = m->tagset[m->seltags];
+      tagstostr(m->pubtags, tags);
+      querysocket_event(NULL, SubTags, "tags %d %s", i, tags);
+    }
+    if ((subpending & SubLayout) && strcmp(m->publtsymbol, m->ltsymbol)) {
+      strcpy(m->publtsymbol, m->ltsymbol);
+      querysocket_event(NULL, SubLayout, "layout %d %s", i, m->ltsymbol);
+    }
+  }
+  if ((subpending & SubMons) && pubnmons != i) {
+    pubnmons = i;
+    querysocket_event(NULL, SubMons, "monitors %d", i);
+  }
+  sel = selmon->sel ? selmon->sel->win : 0;
+  if ((subpending & SubFocus) && pubsel != sel) {
+    pubsel = sel;
+    querysocket_event(NULL, SubFocus, "focus 0x%lx", sel);
+  }
+  if ((subpending & SubOcc) && pubocc != occ) {
+    pubocc = occ;
+    tagstostr(occ, tags);
+    querysocket_event(NULL, SubOcc, "occ %s", tags);
+  }
+  if ((subpending & SubUrg) && puburg != urg) {
+    puburg = urg;
+    tagstostr(urg, tags);
+    querysocket_event(NULL, SubUrg, "urg %s", tags);
   }
-  inputBuf[MAXBUFF_SOCKET - 1] = '\0'; /* Make sure the String ends. */
+  subpending = 0;
+
+  for (q = queryclients; q; q = next) {
+    next = q->next; /* flushing may close q */
+    if (q->outlen)
+      querysocket_flush(q);
+  }
+}
+
+void querysocket_append(QueryClient *q, const void *data, size_t len) {
+  if (q->outlen + len > q->outsize) {
+    q->outsize = MAX(2 * q->outsize, q->outlen + len);
+    if (!(q->out = realloc(q->out, q->outsize)))
+      die("fatal: could not realloc() %u bytes\n", q->outsize);
+  }
+  memcpy(q->out + q->outlen, data, len);
+  q->outlen += len;
+}
+
+/* Sends as much of the output buffer as the socket takes. The rest is sent,
+ * when epoll reports the socket writable again. */
+void querysocket_flush(QueryClient *q) {
+  ssize_t n = 0;
+  size_t off = 0;
+
+  while (off < q->outlen && (n = send(q->src.fd, q->out + off, q->outlen - off,
+				      MSG_DONTWAIT | MSG_NOSIGNAL)) > 0)
+    off += n;
+  if (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+    querysocket_close(q);
+    return;
+  }
+  memmove(q->out, q->out + off, q->outlen - off);
+  q->outlen -= off;
+
+  if (!q->outlen && q->closing) {
+    querysocket_close(q);
+    return;
+  }
+  if (!q->outlen != !q->waitwrite) {
+    q->waitwrite = q->outlen != 0;
+    rewatchfd(&q->src, q->waitwrite ? EPOLLOUT : EPOLLIN);
+  }
+}
+
+void querysocket_close(QueryClient *q) {
+  QueryClient **qp;
+
+  for (qp = &queryclients; *qp && *qp != q; qp = &(*qp)->next)
+    ;
+  if (*qp)
+    *qp = q->next;
+  unwatchfd(&q->src);
+  close(q->src.fd);
+  free(q->out);
+  free(q);
+}
+
+/* Runs the query function named in the input and returns its status. */
+int querysocket_execute(char *inputBuf, char *outputBuf) {
+  int i, used, res;
+  uint64_t t;
+  int (*qfunc)(char *, char *) = NULL;
+  char funcname[MAXBUFF_QUERY];
 
   if (sscanf(inputBuf, "%s %n", funcname, &used) != 1) {
     strncpy(outputBuf, "Could not read function name.", MAXBUFF_SOCKET);
-    goto QueryEnd;
+    return 1;
   }
 
   for (i = 0; i < query_funcs_size; i++) {
@@ -1380,18 +2151,14 @@ void *querysocket_execute(void *arg) {
   }
   if (qfunc == NULL) {
     strncpy(outputBuf, "Could not find function.", MAXBUFF_SOCKET);
-    goto QueryEnd;
+    return 1;
   }
 
+  t = stats_now();
   res = qfunc(&inputBuf[used], outputBuf);
-  outputBuf[MAXBUFF_SOCKET - 1] = '\0';
-
-QueryEnd:
-  send(fd, &res, sizeof(res), 0);
-  send(fd, outputBuf, sizeof(outputBuf), 0);
-
-  close(fd);
-  return NULL;
+  stats_add(querystats[i], t);
+  outputBuf[MAXBUFF_QUERY - 1] = '\0';
+  return res;
 }
 
 Monitor *recttomon(int x, int y, int w, int h) {
@@ -1407,34 +2174,22 @@ Monitor *recttomon(int x, int y, int w, int h) {
 }
 
 void resize(Client *c, int x, int y, int w, int h, int interact, int animate) {
-  unsigned int currgap, n;
-  Client *nbc;
+  unsigned int currgap;
   Monitor *m = c->mon;
 
-  /* Get number of clients for the selected monitor */
-  for (n = 0, nbc = nexttiled(m->cl->clients, m); nbc;
-       nbc = nexttiled(nbc->next, m), n++)
-    ;
-
-  /* Calculate Gaps */
-  if (c->isfloating || interact || m->lt[m->sellt]->arrange == NULL) {
+  /* Calculate Gaps, tiled clients get the same ones in every layout */
+  if (c->isfloating || interact || m->lt[m->sellt]->arrange == NULL)
     currgap = 0;
-  } else {
-    if (m->lt[m->sellt]->arrange == monocle || n == 1) {
-      /* This code is executed, when we have the monocle layout or just one
-       * client. */
-      currgap = gappx;
-      // c.bw = 0;
-    } else {
-      currgap = gappx;
-    }
-  }
+  else
+    currgap = gappx;
 
-  x += currgap;
-  y += currgap;
-  w -= currgap * 2;
-  h -= currgap * 2;
+  resizegoal(c, x + currgap, y + currgap, w - currgap * 2, h - currgap * 2,
+	     interact, animate);
+}
 
+/* Like resize(), but the geometry already leaves out the gaps. */
+void resizegoal(Client *c, int x, int y, int w, int h, int interact,
+		int animate) {
   if (applysizehints(c, &x, &y, &w, &h, interact)) {
     if (animate && c->animate && useanimation && !interact && startupdone &&
 	running && !tempdisableanimation) {
@@ -1442,6 +2197,9 @@ void resize(Client *c, int x, int y, int w, int h, int interact, int animate) {
     } else {
       resizeclient(c, x, y, w, h);
     }
+  } else if (animate) {
+    /* the client is already where the layout wants it */
+    animateclient_cancel(c);
   }
 
   c->goalx = x;
@@ -1450,27 +2208,83 @@ void resize(Client *c, int x, int y, int w, int h, int interact, int animate) {
   c->goalw = w;
 }
 
+/* Changes the geometry of the client and queues the configure request, it is
+ * sent to the server by the next flushconfigures(). Stops any animation of
+ * the client. */
 void resizeclient(Client *c, int x, int y, int w, int h) {
-  XWindowChanges wc;
-  wc.border_width = c->bw;
+  animateclient_cancel(c);
+  setclientgeom(c, x, y, w, h);
+  queueconfigure(c);
+}
 
+void setclientgeom(Client *c, int x, int y, int w, int h) {
   c->oldx = c->x;
-  c->x = wc.x = x;
+  c->x = x;
   c->oldy = c->y;
-  c->y = wc.y = y;
+  c->y = y;
   c->oldw = c->w;
-  c->w = wc.width = w;
+  c->w = w;
   c->oldh = c->h;
-  c->h = wc.height = h;
+  c->h = h;
+}
 
+void sendconfigure(Client *c) {
+  XWindowChanges wc;
+
+  wc.x = c->x;
+  wc.y = c->y;
+  wc.width = c->w;
+  wc.height = c->h;
+  wc.border_width = c->bw;
   XConfigureWindow(dpy, c->win, CWX | CWY | CWWidth | CWHeight | CWBorderWidth,
 		   &wc);
+  XSTAT(configures);
   configure(c);
-  XSync(dpy, False);
-
   roundcornersclient(c);
 }
 
+void queueconfigure(Client *c) {
+  if (c->configpending)
+    return;
+  if (configqueuelen == configqueuesize) {
+    configqueuesize = configqueuesize ? 2 * configqueuesize : 32;
+    if (!(configqueue = realloc(configqueue, configqueuesize * sizeof(Client *))))
+      die("fatal: could not realloc() %u bytes\n",
+	  configqueuesize * sizeof(Client *));
+  }
+  configqueue[configqueuelen++] = c;
+  c->configpending = 1;
+}
+
+/* Needs to be called, before a queued client is freed. */
+void unqueueconfigure(Client *c) {
+  unsigned int i;
+
+  if (!c->configpending)
+    return;
+  for (i = 0; i < configqueuelen && configqueue[i] != c; i++)
+    ;
+  if (i < configqueuelen)
+    memmove(&configqueue[i], &configqueue[i + 1],
+	    (--configqueuelen - i) * sizeof(Client *));
+  c->configpending = 0;
+}
+
+/* Sends all queued geometry changes at once, without waiting for the server. */
+void flushconfigures(void) {
+  unsigned int i;
+
+  if (!configqueuelen)
+    return;
+  for (i = 0; i < configqueuelen; i++) {
+    configqueue[i]->configpending = 0;
+    sendconfigure(configqueue[i]);
+  }
+  configqueuelen = 0;
+  XFlush(dpy);
+  XSTAT(flushes);
+}
+
 void resizemouse(const Arg *arg) {
   int ocx, ocy, nw, nh;
   int ocx2, ocy2, nx, ny;
@@ -1536,6 +2350,7 @@ void resizemouse(const Arg *arg) {
 	resize(c, nx, ny, nw, nh, 1, 0);
       break;
     }
+    arrangepending();
   } while (ev.type != ButtonRelease);
   XWarpPointer(dpy, None, c->win, 0, 0, 0, 0,
 	       horizcorner ? (-c->bw) : (c->w + c->bw - 1),
@@ -1565,6 +2380,8 @@ void restack_nowarp(Monitor *m) {
 
   if (!m->sel)
     return;
+  XSTATS_PUSH(XCtxRestack);
+  flushconfigures(); /* warp() and the stacking depend on the new geometry */
   if (m->sel->isfloating || !m->lt[m->sellt]->arrange)
     XRaiseWindow(dpy, m->sel->win);
   if (m->lt[m->sellt]->arrange) {
@@ -1576,14 +2393,16 @@ void restack_nowarp(Monitor *m) {
 	wc.sibling = c->win;
       }
   }
+  XSTAT(syncs);
   XSync(dpy, False);
   while (XCheckMaskEvent(dpy, EnterWindowMask, &ev))
     ;
+  stackingdirty = 1;
+  XSTATS_POP();
 }
 
 void roundcornersclient(Client *c) {
-  Pixmap mask;
-  GC shapegc;
+  int radius;
 
   if (!cornerradius) {
     return;
@@ -1593,88 +2412,293 @@ void roundcornersclient(Client *c) {
   if (!c || !(c->win) || c->hasroundcorners == 0)
     return;
 
-  // TODO: Cleanup
-  XGrabServer(dpy);
-  // XSync(dpy, False);
-  // XSetErrorhandler(xerrordummy);
+  radius = c->isfullscreen ? 0 : cornerradius;
+  /* The shape is relative to the window, so moving it changes nothing. */
+  if (c->shapew == c->w && c->shapeh == c->h && c->shaper == radius &&
+      c->shapebw == c->bw)
+    return;
+
+  /* The border is part of the bounding shape, but not of the clip shape. */
+  XSTATS_PUSH(XCtxCorners);
+  shaperoundcorners(c->win, ShapeBounding, -c->bw, c->w + 2 * c->bw,
+		    c->h + 2 * c->bw, radius ? radius + c->bw : 0);
+  shaperoundcorners(c->win, ShapeClip, 0, c->w, c->h, radius);
+  XSTATS_POP();
+
+  c->shapew = c->w;
+  c->shapeh = c->h;
+  c->shaper = radius;
+  c->shapebw = c->bw;
+}
 
-  /* Create Border Mask */
-  if (createroundcornermask(&mask, &shapegc, c->win, c->w + 2 * c->bw,
-			    c->h + 2 * c->bw,
-			    c->isfullscreen ? 0 : cornerradius + c->bw) == 0) {
-    XShapeCombineMask(dpy, c->win, ShapeBounding, -c->bw, -c->bw, mask,
-		      ShapeSet);
-    XFreePixmap(dpy, mask);
-    XFreeGC(dpy, shapegc);
+/* Returns how many pixels have to be cut off at both ends of each of the
+ * first radius rows, to get a quarter circle. Tables are computed once per
+ * radius and then reused. */
+const unsigned short *cornerinsets(int radius) {
+  int i, y;
+  double dy;
+
+  if (radius >= ncornertabs) {
+    if (!(cornertabs = realloc(cornertabs, (radius + 1) * sizeof(*cornertabs))))
+      die("fatal: could not realloc() %u bytes\n",
+	  (radius + 1) * sizeof(*cornertabs));
+    for (i = ncornertabs; i <= radius; i++)
+      cornertabs[i] = NULL;
+    ncornertabs = radius + 1;
   }
+  if (!cornertabs[radius]) {
+    cornertabs[radius] = ecalloc(MAX(radius, 1), sizeof(unsigned short));
+    for (y = 0; y < radius; y++) {
+      dy = radius - (y + 0.5);
+      cornertabs[radius][y] = radius - sqrt(radius * radius - dy * dy) + 0.5;
+    }
+  }
+  return cornertabs[radius];
+}
+
+/* Sets the shape of a window with rounded corners as a list of horizontal
+ * spans. Rows of a corner with the same inset are merged into one rectangle. */
+void shaperoundcorners(Window win, int kind, int off, int w, int h,
+		       int radius) {
+  const unsigned short *insets;
+  unsigned int n = 0;
+  int y, top;
 
-  /* Create Clip Mask */
-  if (createroundcornermask(&mask, &shapegc, c->win, c->w, c->h,
-			    c->isfullscreen ? 0 : cornerradius) == 0) {
-    XShapeCombineMask(dpy, c->win, ShapeClip, 0, 0, mask, ShapeSet);
-    XFreePixmap(dpy, mask);
-    XFreeGC(dpy, shapegc);
+  if (w <= 0 || h <= 0)
+    return;
+  if (radius < 0 || w < 2 * radius || h < 2 * radius)
+    radius = 0;
+  if (2 * radius + 1 > shaperectssize) {
+    shaperectssize = 2 * radius + 1;
+    if (!(shaperects = realloc(shaperects, shaperectssize * sizeof(XRectangle))))
+      die("fatal: could not realloc() %u bytes\n",
+	  shaperectssize * sizeof(XRectangle));
   }
 
-  XSync(dpy, False);
-  // XSetErrorhandler(xerror);
-  XUngrabServer(dpy);
+  insets = cornerinsets(radius);
+  for (y = 0; y < radius; y = top) {
+    for (top = y + 1; top < radius && insets[top] == insets[y]; top++)
+      ;
+    shaperects[n++] = (XRectangle){insets[y], y, w - 2 * insets[y], top - y};
+  }
+  shaperects[n++] = (XRectangle){0, radius, w, h - 2 * radius};
+  for (y = radius - 1; y >= 0; y = top) {
+    for (top = y - 1; top >= 0 && insets[top] == insets[y]; top--)
+      ;
+    shaperects[n++] =
+	(XRectangle){insets[y], h - 1 - y, w - 2 * insets[y], y - top};
+  }
+
+  XSTAT(shapes);
+  XShapeCombineRectangles(dpy, win, kind, off, off, shaperects, n, ShapeSet,
+			  YXBanded);
 }
 
-int createroundcornermask(Pixmap *maskP, GC *shapegcP, Window win, int w, int h,
-			  int radius) {
-  Pixmap mask;
-  GC shapegc;
-  XWindowAttributes xwa;
-  int diam = 2 * radius;
+#ifdef XSTATS
+/* Charges the requests sent since the last switch to the current path. */
+static void xstats_switch(XStats *to) {
+  unsigned long next = NextRequest(dpy);
 
-  if (radius < 0)
-    return 1;
+  xstatscur->requests += next - xstatsmark;
+  xstatsmark = next;
+  xstatscur = to;
+}
 
-  // Test and return immediatly, if the window does not exist anymore.
-  if (!(XGetWindowAttributes(dpy, win, &xwa)))
-    return 1;
+void xstats_push(int ctx) {
+  if (xstatsdepth++ < LENGTH(xstatsstack)) {
+    xstatsstack[xstatsdepth - 1] = xstatscur;
+    xstats_switch(&xstatsctx[ctx]);
+  }
+}
 
-  if (!(mask = XCreatePixmap(dpy, win, w, h, 1)))
-    return 1;
+void xstats_pop(void) {
+  if (xstatsdepth && --xstatsdepth < LENGTH(xstatsstack))
+    xstats_switch(xstatsstack[xstatsdepth]);
+}
 
-  if (!(shapegc = XCreateGC(dpy, mask, 0, NULL))) {
-    XFreePixmap(dpy, mask);
-    return 1;
-  }
+void xstats_grab(void) {
+  XSTAT(grabs);
+  xstatsgrabbed = stats_now();
+}
 
-  *maskP = mask;
-  *shapegcP = shapegc;
+void xstats_ungrab(void) {
+  uint64_t d = stats_now() - xstatsgrabbed;
 
-  XFillRectangle(dpy, mask, shapegc, 0, 0, w, h);
-  XSetForeground(dpy, shapegc, 1);
+  xstats.grabns += d;
+  xstatscur->grabns += d;
+}
 
-  if (radius == 0 || w < diam || h < diam) {
-    XFillRectangle(dpy, mask, shapegc, 0, 0, w, h);
-    return 0;
+static int xstats_line(char *out, size_t size, const char *name,
+		       const XStats *x) {
+  return snprintf(out, size,
+		  "%s req %lu reply %lu sync %lu cfg %lu flush %lu prop %lu "
+		  "shape %lu res %lu grab %lu/%luus\n",
+		  name, x->requests, x->replies, x->syncs, x->configures,
+		  x->flushes, x->properties, x->shapes, x->resqueries, x->grabs,
+		  (unsigned long)(x->grabns / 1000));
+}
+
+/* Writes the totals and a line for every code path that sent requests, or
+ * only the line of the path named name. Returns the number of lines. */
+int xstats_format(const char *name, char *out, size_t size) {
+  const char *ctx;
+  size_t len = 0;
+  int i, r, n = 0;
+
+  xstats_switch(xstatscur); /* account what was sent until now */
+  xstats.requests = xstatsmark - 1;
+  out[0] = '\0';
+  if (!name || !strcmp(name, "total")) {
+    if ((r = xstats_line(out, size, "total", &xstats)) < 0 || r >= size)
+      return 0;
+    len = r;
+    n++;
+  }
+  for (i = 0; i < LENGTH(xstatsctx); i++) {
+    ctx = i < XCtxLast ? xstatsnames[i] : handlernames[i - XCtxLast];
+    if (!ctx || (name ? strcmp(name, ctx) : !xstatsctx[i].requests))
+      continue;
+    r = xstats_line(out + len, size - len, ctx, &xstatsctx[i]);
+    if (r < 0 || len + r >= size) {
+      out[len] = '\0'; /* drop the partial line */
+      break;
+    }
+    len += r;
+    n++;
   }
-  /* topleft, topright, bottomleft, bottomright
-   * man XArc - positive is counterclockwise
-   */
-  XFillArc(dpy, mask, shapegc, 0, 0, diam, diam, 90 * 64, 90 * 64);
-  XFillArc(dpy, mask, shapegc, w - diam - 1, 0, diam, diam, 0 * 64, 90 * 64);
-  XFillArc(dpy, mask, shapegc, 0, h - diam - 1, diam, diam, -90 * 64, -90 * 64);
-  XFillArc(dpy, mask, shapegc, w - diam - 1, h - diam - 1, diam, diam, 0 * 64,
-	   -90 * 64);
+  return n;
+}
 
-  XFillRectangle(dpy, mask, shapegc, radius, 0, w - diam, h);
-  XFillRectangle(dpy, mask, shapegc, 0, radius, w, h - diam);
+void xstats_dump(void) {
+  char out[MAXBUFF_QUERY];
 
-  return 0;
+  xstats_format(NULL, out, sizeof(out));
+  fputs(out, stderr);
 }
+#endif /* XSTATS */
 
 void run(void) {
   XEvent ev;
+  struct epoll_event events[16];
+  EventSource *src;
+  int i, n;
+  uint64_t t;
+
   /* main event loop */
   XSync(dpy, False);
-  while (running && !XNextEvent(dpy, &ev))
-    if (handler[ev.type])
-      handler[ev.type](&ev); /* call handler */
+  arrangepending(); /* clients found by scan() */
+  barupdate_publish();
+  while (running) {
+    /* Xlib may have read events from the connection already, epoll would not
+     * report those */
+    if (!XPending(dpy)) {
+      if ((n = epoll_wait(epollfd, events, LENGTH(events), -1)) == -1) {
+	if (errno != EINTR)
+	  die("epoll_wait:");
+	n = 0;
+      }
+      for (i = 0; i < n && running; i++) {
+	src = events[i].data.ptr;
+	if (src->handle)
+	  src->handle(src, events[i].events);
+      }
+    }
+    /* drain everything that is already queued, before doing any layout work */
+    while (running && XPending(dpy)) {
+      XNextEvent(dpy, &ev);
+      if (handler[ev.type]) {
+	t = stats_now();
+	XSTATS_PUSH(XCtxLast + ev.type);
+	handler[ev.type](&ev); /* call handler */
+	XSTATS_POP();
+	stats_add(handlerstats[ev.type], t);
+      }
+    }
+    arrangepending();
+    updateclientlist();
+    querysocket_publish();
+    if (!barupdatedebounce)
+      barupdate_publish();
+  }
+}
+
+int watchfd(EventSource *src, unsigned int events) {
+  struct epoll_event ev = {.events = events, .data.ptr = src};
+
+  return epoll_ctl(epollfd, EPOLL_CTL_ADD, src->fd, &ev) == 0;
+}
+
+int rewatchfd(EventSource *src, unsigned int events) {
+  struct epoll_event ev = {.events = events, .data.ptr = src};
+
+  return epoll_ctl(epollfd, EPOLL_CTL_MOD, src->fd, &ev) == 0;
+}
+
+void unwatchfd(EventSource *src) {
+  epoll_ctl(epollfd, EPOLL_CTL_DEL, src->fd, NULL);
+}
+
+/* Notes that the bar shows outdated state. All changes of one event batch, or
+ * of barupdatedebounce milliseconds, are delivered by one barupdate_publish(). */
+void barupdate(void) {
+  struct itimerspec its = {{0}, {0}};
+
+  if (barpending)
+    return;
+  barpending = 1;
+  if (barupdatedebounce > 0) {
+    its.it_value.tv_sec = barupdatedebounce / 1000;
+    its.it_value.tv_nsec = barupdatedebounce % 1000 * 1000000L;
+    timerfd_settime(bartimer.fd, 0, &its, NULL);
+  }
+}
+
+void barupdate_tick(EventSource *src, unsigned int events) {
+  uint64_t expired;
+
+  /* barupdate() may have rearmed the timer since epoll reported it */
+  if (read(src->fd, &expired, sizeof(expired)) == sizeof(expired))
+    barupdate_publish();
+}
+
+/* Publishes the state a bar shows in the _DWM_BAR_STATE property of the root
+ * window, bars can watch it with PropertyChangeMask. barupdate_cmd is only
+ * run, if it is set. */
+void barupdate_publish(void) {
+  char state[1024], tags[TAGSLENGTH + 1], occtags[TAGSLENGTH + 1],
+      urgtags[TAGSLENGTH + 1];
+  unsigned int occ = 0, urg = 0;
+  int i, len;
+  Monitor *m;
+  Client *c;
+  const Arg a = {.v = barupdate_cmd};
+
+  if (!barpending)
+    return;
+  barpending = 0;
+
+  for (c = cl->clients; c; c = c->next) {
+    occ |= c->tags;
+    if (c->isurgent)
+      urg |= c->tags;
+  }
+  tagstostr(occ, occtags);
+  tagstostr(urg, urgtags);
+  for (i = 0, m = mons; m != selmon; m = m->next, i++)
+    ;
+  len = snprintf(state, sizeof(state), "occ %s\nurg %s\nselmon %d\n", occtags,
+		 urgtags, i);
+  for (i = 0, m = mons; m && len < sizeof(state); m = m->next, i++) {
+    tagstostr(m->tagset[m->seltags], tags);
+    len += snprintf(state + len, sizeof(state) - len, "mon %d %s %s\n", i,
+		    tags, m->ltsymbol);
+  }
+  XSTAT(properties);
+  XChangeProperty(dpy, root, barstateatom, XA_STRING, 8, PropModeReplace,
+		  (unsigned char *)state, MIN(len, sizeof(state) - 1));
+
+  if (barupdate_cmd[0])
+    spawn(&a);
 }
 
 void scan(void) {
@@ -1746,11 +2770,13 @@ void sendmon(Client *c, Monitor *m) {
 void setclientstate(Client *c, long state) {
   long data[] = {state, None};
 
+  XSTAT(properties);
   XChangeProperty(dpy, c->win, wmatom[WMState], wmatom[WMState], 32,
 		  PropModeReplace, (unsigned char *)data, 2);
 }
 void setcurrentdesktop(void) {
   long data[] = {0};
+  XSTAT(properties);
   XChangeProperty(dpy, root, netatom[NetCurrentDesktop], XA_CARDINAL, 32,
 		  PropModeReplace, (unsigned char *)data, 1);
 }
@@ -1768,6 +2794,7 @@ int sendevent(Client *c, Atom proto) {
   int exists = 0;
   XEvent ev;
 
+  XSTAT(replies);
   if (XGetWMProtocols(dpy, c->win, &protocols, &n)) {
     while (!exists && n--)
       exists = protocols[n] == proto;
@@ -1787,6 +2814,7 @@ int sendevent(Client *c, Atom proto) {
 
 void setnumdesktops(void) {
   long data[] = {TAGSLENGTH};
+  XSTAT(properties);
   XChangeProperty(dpy, root, netatom[NetNumberOfDesktops], XA_CARDINAL, 32,
 		  PropModeReplace, (unsigned char *)data, 1);
 }
@@ -1794,6 +2822,7 @@ void setnumdesktops(void) {
 void setfocus(Client *c) {
   if (!c->neverfocus) {
     XSetInputFocus(dpy, c->win, RevertToPointerRoot, CurrentTime);
+    XSTAT(properties);
     XChangeProperty(dpy, root, netatom[NetActiveWindow], XA_WINDOW, 32,
 		    PropModeReplace, (unsigned char *)&(c->win), 1);
   }
@@ -1802,6 +2831,7 @@ void setfocus(Client *c) {
 
 void setfullscreen(Client *c, int fullscreen) {
   if (fullscreen && !c->isfullscreen) {
+    XSTAT(properties);
     XChangeProperty(dpy, c->win, netatom[NetWMState], XA_ATOM, 32,
 		    PropModeReplace, (unsigned char *)&netatom[NetWMFullscreen],
 		    1);
@@ -1810,9 +2840,11 @@ void setfullscreen(Client *c, int fullscreen) {
     c->oldbw = c->bw;
     c->bw = 0;
     c->isfloating = 1;
+    tiledgen++;
     resizeclient(c, c->mon->mx, c->mon->my, c->mon->mw, c->mon->mh);
     XRaiseWindow(dpy, c->win);
   } else if (!fullscreen && c->isfullscreen) {
+    XSTAT(properties);
     XChangeProperty(dpy, c->win, netatom[NetWMState], XA_ATOM, 32,
 		    PropModeReplace, (unsigned char *)0, 0);
     c->isfullscreen = 0;
@@ -1859,7 +2891,8 @@ void setlayoutcustommonitor(const Arg *arg, Monitor *m) {
 
   if (m->sel)
     arrange(m);
-  spawnbarupdate();
+  querysocket_mark(SubLayout);
+  barupdate();
 }
 
 /* arg > 1.0 will set mfact absolutely */
@@ -1898,15 +2931,27 @@ void setgap(const Arg *arg) {
 
 void setup(void) {
   int i;
+  char statname[32];
   XSetWindowAttributes wa;
   Atom utf8string;
   struct sockaddr_un sockaddr;
 
-  /* clean up any zombies immediately */
-  sigchld(0);
-
-  signal(SIGHUP, sighup);
-  signal(SIGTERM, sigterm);
+  if ((epollfd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+    die("Could not create epoll instance.\n");
+
+  /* signals are blocked and handled in the event loop */
+  sigemptyset(&handledsignals);
+  sigaddset(&handledsignals, SIGCHLD);
+  sigaddset(&handledsignals, SIGHUP);
+  sigaddset(&handledsignals, SIGTERM);
+#ifdef XSTATS
+  sigaddset(&handledsignals, SIGUSR1);
+#endif /* XSTATS */
+  if (sigprocmask(SIG_BLOCK, &handledsignals, NULL) == -1 ||
+      (sigsource.fd = signalfd(-1, &handledsignals, SFD_NONBLOCK | SFD_CLOEXEC)) == -1 ||
+      !watchfd(&sigsource, EPOLLIN))
+    die("Could not create signalfd.\n");
+  reapchildren(); /* clean up any zombies immediately */
 
   /* init screen */
   screen = DefaultScreen(dpy);
@@ -1928,34 +2973,71 @@ void setup(void) {
     pertagglist->sellts[i] = 0;
   }
 
-  animatequeue = NULL;
-  if (pthread_mutex_init(&animatemutex, NULL) != 0) {
-    die("Could not create animation mutex.\n");
+  winmap_init(&clientmap);
+  winmap_init(&swallowmap);
+  rules_compile(rules, rules_size);
+  pool_init(&clientpool, sizeof(Client), 64);
+  pool_init(&coldpool, sizeof(ClientCold), 64);
+  for (i = 0; i < LASTEvent; i++)
+    if (handler[i])
+      handlerstats[i] = stats_new(handlernames[i]);
+  arrangestat = stats_new("arrange");
+  managestat = stats_new("manage");
+  focusstat = stats_new("focus");
+  querystats = ecalloc(query_funcs_size, sizeof(Stat *));
+  for (i = 0; i < query_funcs_size; i++) {
+    snprintf(statname, sizeof(statname), "query:%s", query_funcs[i].name);
+    querystats[i] = stats_new(statname);
   }
 
+  xsource.fd = ConnectionNumber(dpy);
+  if (fcntl(xsource.fd, F_SETFD, FD_CLOEXEC) == -1)
+    die("Could not set close-on-exec on the X connection.\n");
+  if (!watchfd(&xsource, EPOLLIN))
+    die("Could not watch X connection.\n");
+  /* non-blocking, the timer may be disarmed between epoll and the read */
+  if ((animtimer.fd = timerfd_create(CLOCK_MONOTONIC,
+				     TFD_CLOEXEC | TFD_NONBLOCK)) == -1 ||
+      !watchfd(&animtimer, EPOLLIN))
+    die("Could not create animation timer.\n");
+  if ((bartimer.fd = timerfd_create(CLOCK_MONOTONIC,
+				    TFD_CLOEXEC | TFD_NONBLOCK)) == -1 ||
+      !watchfd(&bartimer, EPOLLIN))
+    die("Could not create bar update timer.\n");
+  /* without process events, swallowing reads /proc on every lookup */
+  if ((proctreesrc.fd = proctree_init()) != -1 && !watchfd(&proctreesrc, EPOLLIN))
+    proctree_free();
+
   /* Setup Socket */
-  if ((querysocket = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+  if ((querysocket.fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1)
     die("Could not create socket.\n");
   sockaddr.sun_family = AF_UNIX;
-  strncpy(sockaddr.sun_path, SOCKET_PATH, sizeof(sockaddr.sun_path) - 1);
-  if (unlink(SOCKET_PATH) != 0 && errno != ENOENT)
+  if (!(socketpath = getenv(SOCKET_ENV)))
+    socketpath = SOCKET_PATH;
+  strncpy(sockaddr.sun_path, socketpath, sizeof(sockaddr.sun_path) - 1);
+  if (unlink(socketpath) != 0 && errno != ENOENT)
     die("Could not delete old socket.\n");
-  if (bind(querysocket, (struct sockaddr *)&sockaddr, sizeof(sockaddr)) != 0)
+  if (bind(querysocket.fd, (struct sockaddr *)&sockaddr, sizeof(sockaddr)) != 0)
     die("Could not bind socket.\n");
-  if (listen(querysocket, BACKLOG) != 0)
+  if (listen(querysocket.fd, BACKLOG) != 0)
     die("Unable to listen on socket.\n");
-  /* Create new Thread to listen for incomming requests. */
-  if (pthread_create(&querysocket_thread, NULL, querysocket_listen, NULL) != 0)
-    die("Unable to create listening Thread.\n");
+  if (!watchfd(&querysocket, EPOLLIN))
+    die("Unable to watch socket.\n");
 
   gappx = gappxdf;
 
+  if (cornerradius) { /* precompute the tables of the configured radius */
+    cornerinsets(cornerradius);
+    cornerinsets(cornerradius + borderpx);
+  }
+
   root = RootWindow(dpy, screen);
   xinitvisual();
   drw = drw_create(dpy, screen, root, sw, sh, visual, depth, cmap);
   updategeom();
   /* init atoms */
   utf8string = XInternAtom(dpy, "UTF8_STRING", False);
+  barstateatom = XInternAtom(dpy, "_DWM_BAR_STATE", False);
   wmatom[WMProtocols] = XInternAtom(dpy, "WM_PROTOCOLS", False);
   wmatom[WMDelete] = XInternAtom(dpy, "WM_DELETE_WINDOW", False);
   wmatom[WMState] = XInternAtom(dpy, "WM_STATE", False);
@@ -1975,6 +3057,8 @@ void setup(void) {
   netatom[NetWMWindowTypeDialog] =
       XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DIALOG", False);
   netatom[NetClientList] = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
+  netatom[NetClientListStacking] =
+      XInternAtom(dpy, "_NET_CLIENT_LIST_STACKING", False);
   netatom[NetDesktopViewport] =
       XInternAtom(dpy, "_NET_DESKTOP_VIEWPORT", False);
   netatom[NetNumberOfDesktops] =
@@ -2008,6 +3092,7 @@ void setup(void) {
   setdesktopnames();
   setviewport();
   XDeleteProperty(dpy, root, netatom[NetClientList]);
+  XDeleteProperty(dpy, root, netatom[NetClientListStacking]);
   /* select events */
   wa.cursor = cursor[CurNormal]->cursor;
   wa.event_mask = SubstructureRedirectMask | SubstructureNotifyMask |
@@ -2020,6 +3105,7 @@ void setup(void) {
 }
 void setviewport(void) {
   long data[] = {0, 0};
+  XSTAT(properties);
   XChangeProperty(dpy, root, netatom[NetDesktopViewport], XA_CARDINAL, 32,
 		  PropModeReplace, (unsigned char *)data, 2);
 }
@@ -2028,6 +3114,8 @@ void seturgent(Client *c, int urg) {
   XWMHints *wmh;
 
   c->isurgent = urg;
+  querysocket_mark(SubUrg);
+  XSTAT(replies);
   if (!(wmh = XGetWMHints(dpy, c->win)))
     return;
   wmh->flags = urg ? (wmh->flags | XUrgencyHint) : (wmh->flags & ~XUrgencyHint);
@@ -2048,44 +3136,159 @@ void showhide(Client *c) {
   } else {
     /* hide clients bottom up */
     showhide(c->snext);
+    animateclient_cancel(c); /* would move it back into view */
     XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y);
   }
 }
 
-void sigchld(int unused) {
-  if (signal(SIGCHLD, sigchld) == SIG_ERR)
-    die("can't install SIGCHLD handler:");
-  while (0 < waitpid(-1, NULL, WNOHANG))
-    ;
+/* Handles the signals dwm blocked and receives through signalfd instead. */
+void handlesignals(EventSource *src, unsigned int events) {
+  struct signalfd_siginfo si;
+  Arg a;
+
+  while (read(src->fd, &si, sizeof(si)) == sizeof(si)) {
+    switch (si.ssi_signo) {
+    case SIGCHLD:
+      reapchildren();
+      break;
+    case SIGHUP:
+      a.i = 1;
+      quit(&a);
+      break;
+    case SIGTERM:
+      a.i = 0;
+      quit(&a);
+      break;
+#ifdef XSTATS
+    case SIGUSR1:
+      xstats_dump();
+      break;
+#endif /* XSTATS */
+    }
+  }
 }
 
-void sighup(int unused) {
-  Arg a = {.i = 1};
-  quit(&a);
+void proctree_handle(EventSource *src, unsigned int events) {
+  proctree_read();
 }
 
-void sigterm(int unused) {
-  Arg a = {.i = 0};
-  quit(&a);
+void reapchildren(void) {
+  pid_t pid;
+
+  while (0 < (pid = waitpid(-1, NULL, WNOHANG)))
+    launch_forget(pid);
 }
 
+/* Starts a command without forking dwm. All fds of dwm are close-on-exec, so
+ * the child only inherits stdin, stdout and stderr. */
 void spawn(const Arg *arg) {
-  if (fork() == 0) {
-    if (dpy)
-      close(ConnectionNumber(dpy));
-    setsid();
-    execvp(((char **)arg->v)[0], (char **)arg->v);
-    fprintf(stderr, "dwm: execvp %s", ((char **)arg->v)[0]);
-    perror(" failed");
-    exit(EXIT_SUCCESS);
+  char **argv = (char **)arg->v;
+  posix_spawnattr_t attr;
+  sigset_t none;
+  struct timespec start, end;
+  pid_t pid;
+  short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+  int err;
+
+#ifdef POSIX_SPAWN_SETSID
+  flags |= POSIX_SPAWN_SETSID;
+#else
+  flags |= POSIX_SPAWN_SETPGROUP;
+#endif /* POSIX_SPAWN_SETSID */
+  sigemptyset(&none);
+  if ((err = posix_spawnattr_init(&attr)) != 0) {
+    fprintf(stderr, "dwm: spawn %s: %s\n", argv[0], strerror(err));
+    return;
   }
+  posix_spawnattr_setflags(&attr, flags);
+  posix_spawnattr_setsigmask(&attr, &none);
+  posix_spawnattr_setsigdefault(&attr, &handledsignals);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  err = posix_spawnp(&pid, argv[0], NULL, &attr, argv, environ);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  posix_spawnattr_destroy(&attr);
+  if (err != 0) {
+    fprintf(stderr, "dwm: execvp %s failed: %s\n", argv[0], strerror(err));
+    return;
+  }
+  launch_start(argv[0], pid, &start, &end);
 }
 
-void spawnbarupdate() {
-  const Arg a = {.v = barupdate_cmd};
-  spawn(&a);
+unsigned long elapsedus(const struct timespec *from, const struct timespec *to) {
+  return (to->tv_sec - from->tv_sec) * 1000000L +
+	 (to->tv_nsec - from->tv_nsec) / 1000L;
+}
+
+LaunchStats *launch_stats(const char *name) {
+  int i;
+
+  for (i = 0; i < nlaunchstats; i++)
+    if (!strcmp(launchstats[i].name, name))
+      return &launchstats[i];
+  return NULL;
 }
 
+/* Records how long the spawn took and remembers the child, until it maps its
+ * first window or exits. */
+void launch_start(const char *name, pid_t pid, const struct timespec *start,
+		  const struct timespec *exec) {
+  LaunchStats *st;
+  Launch *l;
+  unsigned long us;
+
+  if (!(st = launch_stats(name))) {
+    /* the last slot is shared by all commands that do not fit */
+    st = &launchstats[MIN(nlaunchstats, MAXLAUNCHSTATS - 1)];
+    if (nlaunchstats < MAXLAUNCHSTATS) {
+      nlaunchstats++;
+      strncpy(st->name, name, sizeof(st->name) - 1);
+    }
+  }
+  us = elapsedus(start, exec);
+  st->spawns++;
+  st->spawnsum += us;
+  st->spawnmax = MAX(st->spawnmax, us);
+  lastlaunch = st;
+
+  /* overwrite the oldest launch, if too many never mapped a window */
+  l = &launches[nextlaunch++ % LENGTH(launches)];
+  l->pid = pid;
+  l->exec = *exec;
+  l->stats = st;
+}
+
+/* Called with the pid of every new client, to record its time to map. */
+void launch_mapped(pid_t pid) {
+  struct timespec now;
+  unsigned long us;
+  unsigned int i;
+  LaunchStats *st;
+
+  if (!pid)
+    return;
+  for (i = 0; i < LENGTH(launches) && launches[i].pid != pid; i++)
+    ;
+  if (i == LENGTH(launches))
+    return;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  st = launches[i].stats;
+  us = elapsedus(&launches[i].exec, &now);
+  st->maps++;
+  st->mapsum += us;
+  st->mapmax = MAX(st->mapmax, us);
+  launches[i].pid = 0;
+}
+
+void launch_forget(pid_t pid) {
+  unsigned int i;
+
+  for (i = 0; i < LENGTH(launches); i++)
+    if (launches[i].pid == pid)
+      launches[i].pid = 0;
+}
+
+
 void tag(const Arg *arg) {
   Monitor *m;
   unsigned int newtags;
@@ -2107,7 +3310,8 @@ void tag(const Arg *arg) {
     selmon->sel->tags = arg->ui & TAGMASK;
     focus(NULL);
     arrange(selmon);
-    spawnbarupdate();
+    querysocket_mark(SubOcc | SubFocus);
+    barupdate();
   }
 }
 
@@ -2145,7 +3349,8 @@ void toggletag(const Arg *arg) {
     focus(NULL);
     arrange(selmon);
     updatecurrentdesktop();
-    spawnbarupdate();
+    querysocket_mark(SubOcc | SubFocus);
+    barupdate();
   }
 }
 
@@ -2192,7 +3397,8 @@ void toggleview(const Arg *arg) {
   focus(NULL);
   arrange(selmon);
   updatecurrentdesktop();
-  spawnbarupdate();
+  querysocket_mark(SubTags | SubLayout | SubFocus);
+  barupdate();
 }
 
 void unfocus(Client *c, int setfocus) {
@@ -2217,7 +3423,8 @@ void unmanage(Client *c, int destroyed) {
 
   Client *s = swallowingclient(c->win);
   if (s) {
-    free(s->swallowing);
+    winmap_del(&swallowmap, c->win);
+    freeclient(s->swallowing);
     s->swallowing = NULL;
     arrange(m);
     focus(NULL);
@@ -2226,26 +3433,31 @@ void unmanage(Client *c, int destroyed) {
 
   detach(c);
   detachstack(c);
+  winmap_del(&clientmap, c->win);
+  clientlist_remove(c->win);
   if (!destroyed) {
     wc.border_width = c->oldbw;
     XGrabServer(dpy); /* avoid race conditions */
+    XSTATS_GRAB();
     XSetErrorHandler(xerrordummy);
     XConfigureWindow(dpy, c->win, CWBorderWidth, &wc); /* restore border */
     XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
     setclientstate(c, WithdrawnState);
+    XSTAT(syncs);
     XSync(dpy, False);
     XSetErrorHandler(xerror);
     XUngrabServer(dpy);
+    XSTATS_UNGRAB();
   }
-  free(c);
+  freeclient(c);
 
   if (!s) {
     arrange(m);
     focus(NULL);
-    updateclientlist();
   }
 
-  spawnbarupdate();
+  querysocket_mark(SubOcc | SubUrg | SubFocus);
+  barupdate();
 }
 
 void unmapnotify(XEvent *e) {
@@ -2281,15 +3493,70 @@ void updatebars(void) {
   }
 }
 
-void updateclientlist() {
+/* Writes the client lists with one request each, if they changed. The
+ * stacking order is the order of the stack list, which restack() stacks the
+ * tiled windows by and whose first client is the selected one. */
+void updateclientlist(void) {
+  unsigned int n = 0;
   Client *c;
-  Monitor *m;
 
-  XDeleteProperty(dpy, root, netatom[NetClientList]);
-  for (m = mons; m; m = m->next)
-    for (c = m->cl->clients; c; c = c->next)
-      XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32,
-		      PropModeAppend, (unsigned char *)&(c->win), 1);
+  if (clientlistdirty) {
+    XSTAT(properties);
+    XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32,
+		    PropModeReplace, (unsigned char *)clientlist, nclientlist);
+  }
+  if (!clientlistdirty && !stackingdirty)
+    return;
+  clientlistdirty = stackingdirty = 0;
+  /* sprev of the first client is the last one */
+  if (cl->stack)
+    for (c = cl->stack->sprev; n < clientlistsize; c = c->sprev) {
+      stackinglist[n++] = c->win;
+      if (c == cl->stack)
+	break;
+    }
+  XSTAT(properties);
+  XChangeProperty(dpy, root, netatom[NetClientListStacking], XA_WINDOW, 32,
+		  PropModeReplace, (unsigned char *)stackinglist, n);
+}
+
+void clientlist_add(Window w) {
+  if (nclientlist == clientlistsize) {
+    clientlistsize = clientlistsize ? 2 * clientlistsize : 64;
+    if (!(clientlist = realloc(clientlist, clientlistsize * sizeof(Window))) ||
+	!(stackinglist =
+	      realloc(stackinglist, clientlistsize * sizeof(Window))))
+      die("fatal: could not realloc() %u bytes\n",
+	  clientlistsize * sizeof(Window));
+  }
+  clientlist[nclientlist++] = w;
+  clientlistdirty = 1;
+}
+
+void clientlist_remove(Window w) {
+  unsigned int i;
+
+  for (i = nclientlist; i > 0; i--)
+    if (clientlist[i - 1] == w) {
+      memmove(&clientlist[i - 1], &clientlist[i],
+	      (nclientlist - i) * sizeof(Window));
+      nclientlist--;
+      clientlistdirty = 1;
+      return;
+    }
+}
+
+/* Keeps the position of the client, whose window changed. */
+void clientlist_replace(Window old, Window w) {
+  unsigned int i;
+
+  for (i = 0; i < nclientlist; i++)
+    if (clientlist[i] == old) {
+      clientlist[i] = w;
+      clientlistdirty = 1;
+      return;
+    }
+  clientlist_add(w);
 }
 
 void updatecurrentdesktop(void) {
@@ -2299,6 +3566,7 @@ void updatecurrentdesktop(void) {
     i++;
   }
   long data[] = {i};
+  XSTAT(properties);
   XChangeProperty(dpy, root, netatom[NetCurrentDesktop], XA_CARDINAL, 32,
 		  PropModeReplace, (unsigned char *)data, 1);
 }
@@ -2377,6 +3645,8 @@ int updategeom(void) {
     selmon = mons;
     selmon = wintomon(root);
   }
+  if (dirty)
+    querysocket_mark(SubMons | SubTags | SubLayout);
   return dirty;
 }
 
@@ -2398,9 +3668,16 @@ void updatesizehints(Client *c) {
   long msize;
   XSizeHints size;
 
+  XSTAT(replies);
   if (!XGetWMNormalHints(dpy, c->win, &size, &msize))
     /* size is uninitialized, ensure that size.flags aren't used */
     size.flags = PSize;
+  setsizehints(c, &size);
+}
+
+void setsizehints(Client *c, XSizeHints *hints) {
+  XSizeHints size = *hints;
+
   if (size.flags & PBaseSize) {
     c->basew = size.base_width;
     c->baseh = size.base_height;
@@ -2436,23 +3713,27 @@ void updatesizehints(Client *c) {
 }
 
 void updatetitle(Client *c) {
-  if (!gettextprop(c->win, netatom[NetWMName], c->name, sizeof c->name))
-    gettextprop(c->win, XA_WM_NAME, c->name, sizeof c->name);
-  if (c->name[0] == '\0') /* hack to mark broken clients */
-    strcpy(c->name, broken);
+  if (!gettextprop(c->win, netatom[NetWMName], c->cold->name, sizeof c->cold->name))
+    gettextprop(c->win, XA_WM_NAME, c->cold->name, sizeof c->cold->name);
+  if (c->cold->name[0] == '\0') /* hack to mark broken clients */
+    strcpy(c->cold->name, broken);
 }
 
 void updatewindowtype(Client *c) {
-  Atom state = getatomprop(c, netatom[NetWMState], 0);
-  Atom wtype = getatomprop(c, netatom[NetWMWindowType], 0);
+  setwindowtype(c, getatomprop(c, netatom[NetWMState], 0),
+		getatomprop(c, netatom[NetWMState], 1),
+		getatomprop(c, netatom[NetWMWindowType], 0));
+}
 
+/* state and state2 are the first two atoms of _NET_WM_STATE */
+void setwindowtype(Client *c, Atom state, Atom state2, Atom wtype) {
   if (state == netatom[NetWMFullscreen])
     setfullscreen(c, 1);
   else if (state == netatom[NetWMMaxVert]) {
-    if (getatomprop(c, netatom[NetWMState], 1) == netatom[NetWMMaxHorz])
+    if (state2 == netatom[NetWMMaxHorz])
       setfullscreen(c, 1);
   } else if (state == netatom[NetWMMaxHorz]) {
-    if (getatomprop(c, netatom[NetWMState], 1) == netatom[NetWMMaxVert])
+    if (state2 == netatom[NetWMMaxVert])
       setfullscreen(c, 1);
   }
   if (wtype == netatom[NetWMWindowTypeDialog])
@@ -2462,24 +3743,29 @@ void updatewindowtype(Client *c) {
 void updatewmhints(Client *c) {
   XWMHints *wmh;
 
+  XSTAT(replies);
   if ((wmh = XGetWMHints(dpy, c->win))) {
-    if (c == selmon->sel && wmh->flags & XUrgencyHint) {
-      wmh->flags &= ~XUrgencyHint;
-      XSetWMHints(dpy, c->win, wmh);
-    } else
-      c->isurgent = (wmh->flags & XUrgencyHint) ? 1 : 0;
-    if (wmh->flags & InputHint)
-      c->neverfocus = !wmh->input;
-    else
-      c->neverfocus = 0;
+    setwmhints(c, wmh);
     XFree(wmh);
   }
 }
 
+void setwmhints(Client *c, XWMHints *wmh) {
+  if (c == selmon->sel && wmh->flags & XUrgencyHint) {
+    wmh->flags &= ~XUrgencyHint;
+    XSetWMHints(dpy, c->win, wmh);
+  } else
+    c->isurgent = (wmh->flags & XUrgencyHint) ? 1 : 0;
+  if (wmh->flags & InputHint)
+    c->neverfocus = !wmh->input;
+  else
+    c->neverfocus = 0;
+}
+
 void view(const Arg *arg) {
   Monitor *m;
-  Client *c;
-  unsigned int newtagset = selmon->tagset[selmon->seltags ^ 1];
+  Client **tiled;
+  unsigned int j, ntiled, newtagset = selmon->tagset[selmon->seltags ^ 1];
   int i, n, tagcount, ltag;
   unsigned int tmptag;
 
@@ -2575,12 +3861,12 @@ void view(const Arg *arg) {
 
   /* Count number of clients on new tag and reset layout, if no clients are on
    * new tag. */
+  tiled = tiledclients(selmon, &ntiled);
   for (i = 0; i < TAGSLENGTH; i++) {
     if (1 << i & selmon->tagset[selmon->seltags]) {
       n = 0;
-      for (c = nexttiled(selmon->cl->clients, selmon); c;
-	   c = nexttiled(c->next, selmon)) {
-	if (c->tags & 1 << i) {
+      for (j = 0; j < ntiled; j++) {
+	if (tiled[j]->tags & 1 << i) {
 	  n++;
 	}
       }
@@ -2604,7 +3890,8 @@ void view(const Arg *arg) {
   focus(NULL); /* Focus last client */
   arrange(selmon);
   updatecurrentdesktop();
-  spawnbarupdate();
+  querysocket_mark(SubTags | SubLayout | SubFocus);
+  barupdate();
 }
 
 void viewselected(const Arg *a) {
@@ -2631,19 +3918,172 @@ void warp(const Client *c) {
   XWarpPointer(dpy, None, c->win, 0, 0, 0, 0, c->w / 2, c->h / 2);
 }
 
-pid_t winpid(Window w) {
-  pid_t result = 0;
-
+/* Requests everything manage() needs to know about a window. The replies
+ * have to be collected with the recv* functions below. */
+static void sendprops(Window w, PropCookies *ck) {
   xcb_res_client_id_spec_t spec = {0};
+
   spec.client = w;
   spec.mask = XCB_RES_CLIENT_ID_MASK_LOCAL_CLIENT_PID;
+  XSTAT(resqueries);
+  XSTAT(replies); /* all replies are awaited together */
+  ck->pid = xcb_res_query_client_ids(xcon, 1, &spec);
+  ck->netwmname = xcb_get_property(xcon, 0, w, netatom[NetWMName],
+				   XCB_GET_PROPERTY_TYPE_ANY, 0, 256);
+  ck->wmname = xcb_get_property(xcon, 0, w, XA_WM_NAME,
+				XCB_GET_PROPERTY_TYPE_ANY, 0, 256);
+  ck->trans = xcb_get_property(xcon, 0, w, XA_WM_TRANSIENT_FOR, XA_WINDOW, 0, 1);
+  ck->class = xcb_get_property(xcon, 0, w, XA_WM_CLASS, XA_STRING, 0, 128);
+  ck->state = xcb_get_property(xcon, 0, w, netatom[NetWMState], XA_ATOM, 0, 2);
+  ck->wtype =
+      xcb_get_property(xcon, 0, w, netatom[NetWMWindowType], XA_ATOM, 0, 1);
+  ck->normalhints = xcb_get_property(xcon, 0, w, XA_WM_NORMAL_HINTS,
+				     XA_WM_SIZE_HINTS, 0, 18);
+  ck->hints = xcb_get_property(xcon, 0, w, XA_WM_HINTS, XA_WM_HINTS, 0, 9);
+}
+
+/* Returns NULL, if the property does not exist or has the wrong type. */
+static xcb_get_property_reply_t *recvprop(xcb_get_property_cookie_t ck,
+					  Atom type, int format) {
+  xcb_generic_error_t *e = NULL;
+  xcb_get_property_reply_t *r = xcb_get_property_reply(xcon, ck, &e);
+
+  free(e);
+  if (r && (r->format != format ||
+	    (type != AnyPropertyType && r->type != type) ||
+	    xcb_get_property_value_length(r) <= 0)) {
+    free(r);
+    r = NULL;
+  }
+  return r;
+}
+
+/* Same semantics as gettextprop(). */
+static int recvtextprop(xcb_get_property_cookie_t ck, char *text,
+			unsigned int size) {
+  xcb_get_property_reply_t *r;
+  XTextProperty name;
+  char buf[1025];
+  int len;
+
+  text[0] = '\0';
+  if (!(r = recvprop(ck, AnyPropertyType, 8)))
+    return 0;
+  len = MIN(xcb_get_property_value_length(r), sizeof buf - 1);
+  memcpy(buf, xcb_get_property_value(r), len);
+  buf[len] = '\0';
+  name.value = (unsigned char *)buf;
+  name.encoding = r->type;
+  name.format = 8;
+  name.nitems = len;
+  textproptostr(&name, text, size);
+  free(r);
+  return 1;
+}
 
+/* WM_CLASS holds the instance and the class name, separated by a null byte. */
+static int recvclass(xcb_get_property_cookie_t ck, char *class,
+		     char *instance, unsigned int size) {
+  xcb_get_property_reply_t *r;
+  const char *v;
+  int len, n;
+
+  if (!(r = recvprop(ck, XA_STRING, 8)))
+    return 0;
+  v = xcb_get_property_value(r);
+  len = xcb_get_property_value_length(r);
+  n = strnlen(v, len);
+  snprintf(instance, size, "%.*s", n, v);
+  if (n + 1 < len)
+    snprintf(class, size, "%.*s", (int)strnlen(v + n + 1, len - n - 1),
+	     v + n + 1);
+  else
+    class[0] = '\0';
+  free(r);
+  return 1;
+}
+
+/* Decodes WM_NORMAL_HINTS the way XGetWMNormalHints does. */
+static int recvsizehints(xcb_get_property_cookie_t ck, XSizeHints *size) {
+  xcb_get_property_reply_t *r;
+  int32_t *v;
+  int n;
+
+  if (!(r = recvprop(ck, XA_WM_SIZE_HINTS, 32)))
+    return 0;
+  v = xcb_get_property_value(r);
+  n = xcb_get_property_value_length(r) / 4;
+  if (n < 15) { /* pre ICCCM version 1 */
+    free(r);
+    return 0;
+  }
+  size->flags = v[0];
+  size->x = v[1];
+  size->y = v[2];
+  size->width = v[3];
+  size->height = v[4];
+  size->min_width = v[5];
+  size->min_height = v[6];
+  size->max_width = v[7];
+  size->max_height = v[8];
+  size->width_inc = v[9];
+  size->height_inc = v[10];
+  size->min_aspect.x = v[11];
+  size->min_aspect.y = v[12];
+  size->max_aspect.x = v[13];
+  size->max_aspect.y = v[14];
+  if (n >= 18) {
+    size->base_width = v[15];
+    size->base_height = v[16];
+    size->win_gravity = v[17];
+  } else {
+    size->base_width = size->base_height = 0;
+    size->flags &= ~(PBaseSize | PWinGravity);
+  }
+  free(r);
+  return 1;
+}
+
+/* Decodes WM_HINTS the way XGetWMHints does. */
+static int recvwmhints(xcb_get_property_cookie_t ck, XWMHints *wmh) {
+  xcb_get_property_reply_t *r;
+  uint32_t *v;
+  int n;
+
+  if (!(r = recvprop(ck, XA_WM_HINTS, 32)))
+    return 0;
+  v = xcb_get_property_value(r);
+  n = xcb_get_property_value_length(r) / 4;
+  if (n < 8) {
+    free(r);
+    return 0;
+  }
+  wmh->flags = v[0];
+  wmh->input = v[1] ? True : False;
+  wmh->initial_state = v[2];
+  wmh->icon_pixmap = v[3];
+  wmh->icon_window = v[4];
+  wmh->icon_x = (int32_t)v[5];
+  wmh->icon_y = (int32_t)v[6];
+  wmh->icon_mask = v[7];
+  if (n >= 9)
+    wmh->window_group = v[8];
+  else {
+    wmh->window_group = 0;
+    wmh->flags &= ~WindowGroupHint;
+  }
+  free(r);
+  return 1;
+}
+
+static pid_t recvpid(xcb_res_query_client_ids_cookie_t ck) {
+  pid_t result = 0;
+  xcb_res_client_id_spec_t spec;
   xcb_generic_error_t *e = NULL;
-  xcb_res_query_client_ids_cookie_t c =
-      xcb_res_query_client_ids(xcon, 1, &spec);
   xcb_res_query_client_ids_reply_t *r =
-      xcb_res_query_client_ids_reply(xcon, c, &e);
+      xcb_res_query_client_ids_reply(xcon, ck, &e);
 
+  free(e);
   if (!r)
     return (pid_t)0;
 
@@ -2665,80 +4105,26 @@ pid_t winpid(Window w) {
   return result;
 }
 
-pid_t getparentprocess(pid_t p) {
-  unsigned int v = 0;
-
-#if defined(__linux__)
-  FILE *f;
-  char buf[256];
-  snprintf(buf, sizeof(buf) - 1, "/proc/%u/stat", (unsigned)p);
-
-  if (!(f = fopen(buf, "r")))
-    return (pid_t)0;
-
-  if (fscanf(f, "%*u %*s %*c %u", (unsigned *)&v) != 1)
-    v = (pid_t)0;
-  fclose(f);
-#elif defined(__FreeBSD__)
-  struct kinfo_proc *proc = kinfo_getproc(p);
-  if (!proc)
-    return (pid_t)0;
-
-  v = proc->ki_ppid;
-  free(proc);
-#endif
-  return (pid_t)v;
-}
-
-int isdescprocess(pid_t p, pid_t c) {
-  while (p != c && c != 0)
-    c = getparentprocess(c);
-
-  return (int)c;
-}
-
+/* Returns the terminal that started the window, the nearest one if they are
+ * nested. The process tree is walked up only once, from the window. */
 Client *termforwin(const Client *w) {
   Client *c;
-  Monitor *m;
+  pid_t p;
 
-  if (!w->pid || w->isterminal)
+  if (!w->cold->pid || w->cold->isterminal)
     return NULL;
 
-  for (m = mons; m; m = m->next) {
-    for (c = m->cl->clients; c; c = c->next) {
-      if (c->isterminal && !c->swallowing && c->pid &&
-          isdescprocess(c->pid, w->pid))
-        return c;
-    }
-  }
-
-  return NULL;
-}
-
-Client *swallowingclient(Window w) {
-  Client *c;
-  Monitor *m;
-
-  for (m = mons; m; m = m->next) {
-    for (c = m->cl->clients; c; c = c->next) {
-      if (c->swallowing && c->swallowing->win == w)
-        return c;
-    }
-  }
+  for (p = w->cold->pid; p > 0; p = proctree_parent(p))
+    for (c = cl->clients; c; c = c->next)
+      if (c->cold->isterminal && !c->swallowing && c->cold->pid == p)
+	return c;
 
   return NULL;
 }
 
-Client *wintoclient(Window w) {
-  Client *c;
-  Monitor *m;
+Client *swallowingclient(Window w) { return winmap_get(&swallowmap, w); }
 
-  for (m = mons; m; m = m->next)
-    for (c = m->cl->clients; c; c = c->next)
-      if (c->win == w)
-        return c;
-  return NULL;
-}
+Client *wintoclient(Window w) { return winmap_get(&clientmap, w); }
 
 Monitor *wintomon(Window w) {
   int x, y;
@@ -2840,7 +4226,7 @@ void zoom(const Arg *arg) {
     if (!c || !(c = nexttiled(c->next, selmon)))
       return;
   pop(c);
-  spawnbarupdate();
+  barupdate();
 }
 
 int main(int argc, char *argv[]) {
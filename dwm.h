@@ -2,6 +2,12 @@
 #define DWM_H
 
 #include <X11/Xft/Xft.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "layoutgeom.h"
+#include "sockdef.h"
 
 /* macros */
 #define BUTTONMASK              (ButtonPressMask|ButtonReleaseMask)
@@ -11,9 +17,7 @@
 #define ISVISIBLE(C, M)         ((C->tags & M->tagset[M->seltags]))
 #define MOUSEMASK               (BUTTONMASK|PointerMotionMask)
 #define WIDTH(X)                ((X)->w + 2 * (X)->bw + 2*gappx)
-#define WIDTH_G(X)              ((X)->goalw + 2 * (X)->bw + 2*gappx)
 #define HEIGHT(X)               ((X)->h + 2 * (X)->bw + 2*gappx)
-#define HEIGHT_G(X)             ((X)->goalh + 2 * (X)->bw + 2*gappx)
 #define TAGMASK                 ((1 << NUMTAGS) - 1)
 #define TAGSLENGTH              (NUMTAGS)
 #define XRDB_LOAD_COLOR(R,V)    if (XrmGetResource(xrdb, R, NULL, &type, &value) == True) { \
@@ -37,9 +41,12 @@ enum { CurNormal, CurResize, CurMove, CurLast }; /* cursor */
 enum { SchemeNorm, SchemeSel }; /* color schemes */
 enum { NetSupported, NetWMName, NetWMState, NetWMCheck,
        NetWMFullscreen, NetWMMaxVert, NetWMMaxHorz, NetActiveWindow, NetWMWindowType,
-       NetWMWindowTypeDialog, NetClientList, NetDesktopNames, NetDesktopViewport, NetNumberOfDesktops, NetCurrentDesktop, NetLast }; /* EWMH atoms */
+       NetWMWindowTypeDialog, NetClientList, NetClientListStacking, NetDesktopNames, NetDesktopViewport, NetNumberOfDesktops, NetCurrentDesktop, NetLast }; /* EWMH atoms */
 enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMLast }; /* default atoms */
 enum { ClkClientWin, ClkRootWin, ClkLast }; /* clicks */
+enum { ArrangeLayout = 1 << 0, ArrangeStack = 1 << 1 }; /* pending arrange work */
+enum { SubTags = 1 << 0, SubFocus = 1 << 1, SubLayout = 1 << 2, SubOcc = 1 << 3,
+       SubUrg = 1 << 4, SubMons = 1 << 5, SubAll = (1 << 6) - 1 }; /* subscription events */
 
 typedef union {
 	int i;
@@ -58,24 +65,36 @@ typedef struct {
 
 typedef struct Monitor Monitor;
 typedef struct Client Client;
-struct Client {
+/* What walks of the client lists do not need: the title, and what the rules
+ * and the process tree say about swallowing. */
+typedef struct {
 	char name[256];
-	float mina, maxa;
-	int x, y, w, h;
-	int oldx, oldy, oldw, oldh;
-	int goalx, goaly, goalw, goalh;
-	int basew, baseh, incw, inch, maxw, maxh, minw, minh;
-	int bw, oldbw;
-	unsigned int tags;
-	int isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen,
-	    isterminal, noswallow, useresizehints, animate, hasroundcorners,
-	    animateresize;
 	pid_t pid;
-	Client *next;
-	Client *snext;
-	Client *swallowing;
+	int isterminal, noswallow;
+} ClientCold;
+
+/* Clients and their cold parts come from pools, see newclient(). The fields
+ * used by list walks, visibility checks and layouts are kept together at the
+ * start. */
+struct Client {
+	Client *next, *prev;
+	Client *snext, *sprev;
 	Monitor *mon;
+	unsigned int tags;
+	int isfloating, isfullscreen, isurgent, neverfocus, configpending;
+	int x, y, w, h;
+	int goalx, goaly, goalw, goalh;
+	int bw;
 	Window win;
+	Client *swallowing;
+	int useresizehints, animate, hasroundcorners, animateresize;
+	float mina, maxa;
+	int basew, baseh, incw, inch, maxw, maxh, minw, minh;
+	int isfixed, oldstate;
+	int oldx, oldy, oldw, oldh;
+	int oldbw;
+	int shapew, shapeh, shaper, shapebw; /* last applied corner shape */
+	ClientCold *cold;
 };
 
 typedef struct {
@@ -85,6 +104,11 @@ typedef struct {
 	const Arg arg;
 } Key;
 
+typedef struct {
+	unsigned int mod; /* CLEANMASK of the modifiers of key */
+	const Key *key;
+} KeyBinding;
+
 typedef struct {
 	const char * sig;
 	void (*func)(const Arg *);
@@ -112,7 +136,12 @@ struct Monitor {
 	unsigned int seltags;
 	unsigned int sellt;
 	unsigned int tagset[2];
+	unsigned int needarrange; /* Arrange* flags, handled by arrangepending() */
+	unsigned int pubtags;     /* tagset and layout symbol, as published */
+	char publtsymbol[16];     /* to subscribers of the query socket */
 	Clientlist *cl;
+	Client **tiled;       /* visible tiled clients, see tiledclients() */
+	unsigned int ntiled, tiledsize, tiledgen;
 	Client *sel;	      /* Focused Client */
 	Monitor *next;
 	Window barwin;
@@ -136,31 +165,113 @@ typedef struct {
 	int noanimateresize;
 } Rule;
 
+/* Both lists end in NULL going forward, while the prev pointer of the first
+ * client points to the last one, so clients can be removed and the lists
+ * walked backwards without searching. */
 struct Clientlist {
 	Client *clients;
 	Client *stack;
 };
 
-typedef struct AnimateThreadArg {
-	int x, y, w, h;
-	Client * c;
-	pthread_t thread;
-	struct AnimateThreadArg * next;
-} AnimateThreadArg;
+#ifdef XSTATS
+typedef struct {
+	unsigned long requests;   /* protocol requests sent */
+	unsigned long replies;    /* other blocking round trips */
+	unsigned long syncs;      /* blocking XSync round trips */
+	unsigned long configures; /* ConfigureWindow requests for clients */
+	unsigned long flushes;    /* flushes of the configure queue */
+	unsigned long properties; /* ChangeProperty requests */
+	unsigned long shapes;     /* shape requests for rounded corners */
+	unsigned long resqueries; /* X-Resource queries for client pids */
+	unsigned long grabs;      /* server grabs */
+	uint64_t grabns;          /* time the server was grabbed */
+} XStats;
+/* Code paths that are counted separately, each without the paths entered
+ * from it. The event handlers follow, at XCtxLast + event type. */
+enum { XCtxOther, XCtxArrange, XCtxFocus, XCtxRestack, XCtxCorners, XCtxLast };
+#define XSTAT(F) (xstats.F++, xstatscur->F++)
+#define XSTATS_PUSH(C) xstats_push(C)
+#define XSTATS_POP() xstats_pop()
+#define XSTATS_GRAB() xstats_grab()
+#define XSTATS_UNGRAB() xstats_ungrab()
+#else
+#define XSTAT(F)
+#define XSTATS_PUSH(C)
+#define XSTATS_POP()
+#define XSTATS_GRAB()
+#define XSTATS_UNGRAB()
+#endif /* XSTATS */
+
+/* A file descriptor served by the event loop, handle() is called whenever
+ * epoll reports it ready. */
+typedef struct EventSource EventSource;
+struct EventSource {
+	int fd;
+	void (*handle)(EventSource *src, unsigned int events);
+};
+
+/* A connection to the query socket. It stays open until the peer closes it,
+ * unless it speaks the old protocol with one request per connection. */
+typedef struct QueryClient {
+	EventSource src; /* must be first */
+	char in[sizeof(uint32_t) + MAXBUFF_QUERY];
+	unsigned int inlen;
+	char *out; /* responses not sent yet */
+	size_t outlen, outsize;
+	int framed, legacy, closing, waitwrite;
+	unsigned int subscribed; /* Sub* events sent to this connection */
+	struct QueryClient *next;
+} QueryClient;
+
+#define MAXLAUNCHSTATS 32
+
+/* Latency of the commands started by spawn(), in microseconds. */
+typedef struct {
+	char name[32];
+	unsigned long spawns, maps;
+	unsigned long spawnsum, spawnmax; /* from posix_spawn() until exec */
+	unsigned long mapsum, mapmax;     /* from exec until the first window */
+} LaunchStats;
+
+typedef struct {
+	pid_t pid; /* 0 for unused slots */
+	struct timespec exec;
+	LaunchStats *stats;
+} Launch;
+
+extern LaunchStats launchstats[MAXLAUNCHSTATS];
+extern int nlaunchstats;
+extern LaunchStats *lastlaunch;
+
+typedef struct Animation {
+	Client *c;
+	int fromx, fromy, fromw, fromh;
+	int x, y, w, h; /* goal */
+	int frame, frames;
+	struct Animation *next;
+} Animation;
 
 /* function declarations */
-void animateclient(Client *c, int x, int y, int w, int h);
-void * animateclient_thread(void * arg);
-void animateclient_start(Client * c, int x, int y, int w, int h);
-void animateclient_endall();
-void applyrules(Client *c);
+void animateclient_start(Client *c, int x, int y, int w, int h);
+void animateclient_frame(void);
+void animateclient_cancel(Client *c);
+Animation *animateclient_find(Client *c);
+void animateclient_tick(EventSource *src, unsigned int events);
+void animateclient_endall(void);
+void applyrules(Client *c, const char *class, const char *instance);
 int applysizehints(Client *c, int *x, int *y, int *w, int *h, int interact);
 void arrange(Monitor *m);
 void arrangemon(Monitor *m);
+void arrangepending(void);
+void applylayout(Client **c, const Rect *r, unsigned int n);
 void attach(Client *c);
+void barupdate(void);
+void barupdate_publish(void);
+void barupdate_tick(EventSource *src, unsigned int events);
 void attachclients(Monitor *m);
 void attachstack(Client *c);
 int fake_signal(void);
+const Signal *findsignal(const char *name, size_t len);
 void buttonpress(XEvent *e);
 void checkotherwm(void);
 void cleanup(void);
@@ -174,43 +285,75 @@ void destroynotify(XEvent *e);
 void detach(Client *c);
 void detachstack(Client *c);
 Monitor *dirtomon(int dir);
+unsigned long elapsedus(const struct timespec *from, const struct timespec *to);
 void enternotify(XEvent *e);
+void flushconfigures(void);
 void focus(Client *c);
 void focusin(XEvent *e);
 void focusmon(const Arg *arg);
 void focusstack(const Arg *arg);
 Atom getatomprop(Client *c, Atom prop, int num);
+int getfsignal(char *text, unsigned int size);
 int getrootptr(int *x, int *y);
 long getstate(Window w);
 int gettextprop(Window w, Atom atom, char *text, unsigned int size);
 void grabbuttons(Client *c, int focused);
 void grabkeys(void);
+void handlesignals(EventSource *src, unsigned int events);
 void incnmaster(const Arg *arg);
 void keypress(XEvent *e);
 void killclient(const Arg *arg);
+void launch_forget(pid_t pid);
+void launch_mapped(pid_t pid);
+void launch_start(const char *name, pid_t pid, const struct timespec *start,
+		  const struct timespec *exec);
+LaunchStats *launch_stats(const char *name);
 void loadxrdb(void);
 void manage(Window w, XWindowAttributes *wa);
 void mappingnotify(XEvent *e);
 void maprequest(XEvent *e);
 void motionnotify(XEvent *e);
 void movemouse(const Arg *arg);
+Client *newclient(void);
+void freeclient(Client *c);
 Client *nexttiled(Client *c, Monitor *m);
+Client **tiledclients(Monitor *m, unsigned int *n);
 void overview(const Arg *arg);
 void pop(Client *);
 void propertynotify(XEvent *e);
+void proctree_handle(EventSource *src, unsigned int events);
+void queueconfigure(Client *c);
 void quit(const Arg *arg);
-void * querysocket_listen(void * arg);
-void * querysocket_execute(void * arg);
+void querysocket_accept(EventSource *src, unsigned int events);
+void querysocket_append(QueryClient *q, const void *data, size_t len);
+void querysocket_close(QueryClient *q);
+int querysocket_execute(char *inputBuf, char *outputBuf);
+void querysocket_flush(QueryClient *q);
+void querysocket_handle(EventSource *src, unsigned int events);
+void querysocket_event(QueryClient *q, unsigned int event, const char *fmt, ...);
+void querysocket_mark(unsigned int events);
+void querysocket_publish(void);
+void querysocket_read(QueryClient *q);
+void querysocket_respond(QueryClient *q, unsigned int off, char *legacy);
+void querysocket_sendstate(QueryClient *q, unsigned int events);
+int querysocket_subscribe(QueryClient *q, char *args, char *output);
+void reapchildren(void);
 Monitor *recttomon(int x, int y, int w, int h);
 void resize(Client *c, int x, int y, int w, int h, int interact, int animate);
+void resizegoal(Client *c, int x, int y, int w, int h, int interact,
+		int animate);
 void resizeclient(Client *c, int x, int y, int w, int h);
 void resizemouse(const Arg *arg);
 void restack(Monitor *m);
+int rewatchfd(EventSource *src, unsigned int events);
 void restack_nowarp(Monitor *m);
 void run(void);
+int runsignal(char *s);
 void scan(void);
+void sendconfigure(Client *c);
 int sendevent(Client *c, Atom proto);
 void sendmon(Client *c, Monitor *m);
+void setclientgeom(Client *c, int x, int y, int w, int h);
 void setclientstate(Client *c, long state);
 void setcurrentdesktop(void);
 void setdesktopnames(void);
@@ -219,28 +362,35 @@ void setfullscreen(Client *c, int fullscreen);
 void setlayout(const Arg *arg);
 void setlayoutcustommonitor(const Arg *arg, Monitor *m);
 void setmfact(const Arg *arg);
+void setsizehints(Client *c, XSizeHints *size);
 void setgap(const Arg *arg);
 void setnumdesktops(void);
 void setup(void);
 void setviewport(void);
 void seturgent(Client *c, int urg);
+void setwindowtype(Client *c, Atom state, Atom state2, Atom wtype);
+void setwmhints(Client *c, XWMHints *wmh);
 void showhide(Client *c);
-void sigchld(int unused);
-void sighup(int unused);
-void sigterm(int unused);
+unsigned int sighash(const char *s, size_t len);
 void spawn(const Arg *arg);
-void spawnbarupdate();
 void tag(const Arg *arg);
 void tagmon(const Arg *arg);
+void tagstostr(unsigned int tags, char *s);
+void textproptostr(XTextProperty *name, char *text, unsigned int size);
 void togglefloating(const Arg *arg);
 void toggletag(const Arg *arg);
 void toggleview(const Arg *arg);
 void unfocus(Client *c, int setfocus);
 void unmanage(Client *c, int destroyed);
+void unwatchfd(EventSource *src);
 void unmapnotify(XEvent *e);
+void unqueueconfigure(Client *c);
 void updatecurrentdesktop(void);
 void updatebars(void);
 void updateclientlist(void);
+void clientlist_add(Window w);
+void clientlist_remove(Window w);
+void clientlist_replace(Window old, Window w);
 int updategeom(void);
 void updatenumlockmask(void);
 void updatesizehints(Client *c);
@@ -249,6 +399,7 @@ void updatewindowtype(Client *c);
 void updatewmhints(Client *c);
 void view(const Arg *arg);
 void viewselected(const Arg *arg);
+int watchfd(EventSource *src, unsigned int events);
 void warp(const Client *c);
 Client *wintoclient(Window w);
 Monitor *wintomon(Window w);
@@ -261,16 +412,23 @@ void zoom(const Arg *arg);
 void bstack(Monitor *m);
 void bstackhoriz(Monitor *m);
 void roundcornersclient(Client *c);
-int createroundcornermask(Pixmap * maskP, GC * shapegcP, Window win, int w, int h, int radius);
-pid_t getparentprocess(pid_t p);
-int isdescprocess(pid_t p, pid_t c);
+const unsigned short *cornerinsets(int radius);
+void shaperoundcorners(Window win, int kind, int off, int w, int h, int radius);
 Client *swallowingclient(Window w);
 Client *termforwin(const Client *c);
-pid_t winpid(Window w);
 
 extern Clientlist *cl;
 extern Monitor *mons, *selmon;
 extern unsigned int gappx;
+#ifdef XSTATS
+extern XStats xstats, *xstatscur;
+void xstats_push(int ctx);
+void xstats_pop(void);
+void xstats_grab(void);
+void xstats_ungrab(void);
+int xstats_format(const char *name, char *out, size_t size);
+void xstats_dump(void);
+#endif /* XSTATS */
 
 #endif /* DWM_H */
 
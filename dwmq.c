@@ -1,4 +1,6 @@
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
@@ -6,50 +8,165 @@
 
 #include "sockdef.h"
 
+static int sendall(int sock, const char * buf, size_t len) {
+	ssize_t n;
+	while (len > 0) {
+		if ((n = send(sock, buf, len, 0)) <= 0)
+			return -1;
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int recvall(int sock, void * buf, size_t len) {
+	ssize_t n;
+	char * p = buf;
+	while (len > 0) {
+		if ((n = recv(sock, p, len, 0)) <= 0)
+			return -1;
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/* Appends a request frame to the buffer, which is grown as needed. */
+static int appendquery(char ** buf, size_t * used, size_t * size, uint32_t id, const char * text) {
+	uint32_t len = sizeof(id) + strlen(text);
+	if (len > MAXBUFF_QUERY) {
+		fprintf(stderr, "Input to long.\n");
+		return -1;
+	}
+	if (*used + sizeof(len) + len > *size) {
+		*size = 2 * (*used + sizeof(len) + len);
+		if (!(*buf = realloc(*buf, *size))) {
+			fprintf(stderr, "Out of memory.\n");
+			return -1;
+		}
+	}
+	memcpy(*buf + *used, &len, sizeof(len));
+	memcpy(*buf + *used + sizeof(len), &id, sizeof(id));
+	memcpy(*buf + *used + sizeof(len) + sizeof(id), text, len - sizeof(id));
+	*used += sizeof(len) + len;
+	return 0;
+}
+
+/* Reads one response frame, the output is stored as a string. */
+static int recvresponse(int sock, uint32_t * id, int32_t * status, char * output) {
+	uint32_t len;
+	if (recvall(sock, &len, sizeof(len)) != 0 || len < sizeof(*id) + sizeof(*status)
+	    || len - sizeof(*id) - sizeof(*status) >= MAXBUFF_QUERY) {
+		fprintf(stderr, "Could not read response.\n");
+		return -1;
+	}
+	len -= sizeof(*id) + sizeof(*status);
+	if (recvall(sock, id, sizeof(*id)) != 0 || recvall(sock, status, sizeof(*status)) != 0
+	    || recvall(sock, output, len) != 0) {
+		fprintf(stderr, "Could not read response.\n");
+		return -1;
+	}
+	output[len] = '\0';
+	return 0;
+}
+
 int main(int argc, char ** argv) {
 	struct sockaddr_un addr;
-	int sock, i, returnValue;
-	int used = 0;
-	char inBuf[MAXBUFF_SOCKET];
-	char outBuf[MAXBUFF_SOCKET];
+	int sock, i, batch;
+	int32_t returnValue = 0, status;
+	uint32_t id, n = 0;
+	size_t used = 0, size = 0, l, inUsed = 0;
+	char * buf = NULL;
+	char ** outputs = NULL;
+	const char * path;
+	char inBuf[MAXBUFF_QUERY];
+	char outBuf[MAXBUFF_QUERY];
 
 	if (argc <= 1) {
 		fprintf(stderr, "No function provided.\n");
 		return -1;
 	}
+	/* with -b, every line of stdin is a query and all are sent at once */
+	batch = strcmp(argv[1], "-b") == 0;
 
 	if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
 		fprintf(stderr, "Could not create socket.\n");
 		return -1;
 	}
 	addr.sun_family = AF_UNIX;
-	strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
+	if (!(path = getenv(SOCKET_ENV)))
+		path = SOCKET_PATH;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
 	if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
 		fprintf(stderr, "Could not connect to socket.\n");
 		return -1;
 	}
-	
-	strncpy(inBuf, argv[1], MAXBUFF_SOCKET);
-	for (i = 2; i < argc; i++) {
-		int l = strlen(argv[i]);
-		if (used + l + 1 > MAXBUFF_SOCKET) {
-			fprintf(stderr, "Input to long.\n");
-			return -1;
+
+	if (batch) {
+		while (fgets(inBuf, sizeof(inBuf), stdin)) {
+			inBuf[strcspn(inBuf, "\n")] = '\0';
+			if (inBuf[0] == '\0')
+				continue;
+			if (appendquery(&buf, &used, &size, n++, inBuf) != 0)
+				return -1;
+		}
+	} else {
+		inBuf[0] = '\0';
+		for (i = 1; i < argc; i++) {
+			l = strlen(argv[i]);
+			if (inUsed + l + 1 >= MAXBUFF_QUERY - sizeof(id)) {
+				fprintf(stderr, "Input to long.\n");
+				return -1;
+			}
+			if (i > 1)
+				strcat(inBuf, " ");
+			strcat(inBuf, argv[i]);
+			inUsed += l + 1;
 		}
-		strcat(inBuf, " ");
-		strncat(inBuf, argv[i], MAXBUFF_SOCKET - used);
-		used += l + 1;
+		if (appendquery(&buf, &used, &size, n++, inBuf) != 0)
+			return -1;
 	}
 
-	send(sock, inBuf, MAXBUFF_SOCKET, 0);
+	if (n > 0 && sendall(sock, buf, used) != 0) {
+		fprintf(stderr, "Could not send queries.\n");
+		return -1;
+	}
+	free(buf);
 
-	recv(sock, &returnValue, sizeof(returnValue), 0);
-	recv(sock, outBuf, MAXBUFF_SOCKET, 0);
+	/* responses may be matched to their requests by id */
+	if (n > 0 && !(outputs = calloc(n, sizeof(char *)))) {
+		fprintf(stderr, "Out of memory.\n");
+		return -1;
+	}
+	for (i = 0; i < n; i++) {
+		if (recvresponse(sock, &id, &status, outBuf) != 0)
+			return -1;
+		if (id == SUBSCRIBE_EVENTID) { /* the query was "subscribe" */
+			i--;
+			continue;
+		}
+		if (id >= n)
+			return -1;
+		if (status != 0)
+			returnValue = batch ? 1 : status;
+		outputs[id] = strdup(outBuf);
+	}
 
+	for (i = 0; i < n; i++) {
+		printf("%s\n", outputs[i] ? outputs[i] : "");
+		free(outputs[i]);
+	}
+	free(outputs);
+
+	/* print the events of a subscription, until dwm goes away */
+	if (!batch && returnValue == 0 && strncmp(inBuf, "subscribe", 9) == 0) {
+		fflush(stdout);
+		while (recvresponse(sock, &id, &status, outBuf) == 0) {
+			printf("%s\n", outBuf);
+			fflush(stdout);
+		}
+	}
 	close(sock);
 
-	printf("%s\n", outBuf);
-	
 	return returnValue;
 }
-
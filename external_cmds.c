@@ -2,6 +2,7 @@
 #include "sockdef.h"
 #include "dwm.h"
 #include "config.h"
+#include "stats.h"
 #include "util.h"
 
 // === DWMC Extra Functions ===
@@ -202,7 +203,7 @@ int querySelWin(char * input, char * output) {
 
 	for (c = selmon->cl->stack; c; c = c->snext) {
 		if (c->tags & tagmask) {
-			/* strncpy(output, c->name, MAXBUFF_SOCKET); */
+			/* strncpy(output, c->cold->name, MAXBUFF_SOCKET); */
 			snprintf(output, MAXBUFF_SOCKET, "0x%lx", c->win);
 			return 0;
 		}
@@ -225,7 +226,7 @@ int queryMasterWin(char * input, char * output) {
 
 	for (c = selmon->cl->clients; c; c = c->next) {
 		if (c->tags & tagmask && !c->isfloating) {
-			/* strncpy(output, c->name, MAXBUFF_SOCKET); */
+			/* strncpy(output, c->cold->name, MAXBUFF_SOCKET); */
 			snprintf(output, MAXBUFF_SOCKET, "0x%lx", c->win);
 			return 0;
 		}
@@ -234,6 +235,63 @@ int queryMasterWin(char * input, char * output) {
 	return 1;
 }
 
+/* Launch latency of the given command, or of the last one spawned:
+ * average and maximum of spawn until exec in us, exec until map in ms. */
+int querySpawnStats(char * input, char * output) {
+	char name[32];
+	LaunchStats * st = lastlaunch;
+
+	if (sscanf(input, "%31s", name) == 1)
+		st = launch_stats(name);
+	if (!st)
+		return 1;
+	snprintf(output, MAXBUFF_QUERY, "%s %lux exec %lu/%luus %lux map %lu/%lums",
+	         st->name, st->spawns, st->spawnsum / st->spawns, st->spawnmax,
+	         st->maps, st->maps ? st->mapsum / st->maps / 1000 : 0, st->mapmax / 1000);
+	return 0;
+}
+
+/* Runs a signal, "signal view ui 4" does what
+ * `xsetroot -name "fsignal:view ui 4"` does. */
+int querySignal(char * input, char * output) {
+	if (!runsignal(input)) {
+		strcpy(output, "Could not find signal.");
+		return 1;
+	}
+	return 0;
+}
+
+/* Latency histograms, of all stats that counted something or of the one
+ * named, e.g. "stats PropertyNotify". Unlike other outputs, this one may be
+ * longer than MAXBUFF_SOCKET, so it needs the framed protocol. */
+int queryStats(char * input, char * output) {
+	char name[32];
+
+	if (sscanf(input, "%31s", name) == 1)
+		return !stats_format(name, output, MAXBUFF_QUERY);
+	stats_format(NULL, output, MAXBUFF_QUERY);
+	return 0;
+}
+
+int queryStatsReset(char * input, char * output) {
+	stats_reset();
+	return 0;
+}
+
+#ifdef XSTATS
+/* X requests and round trips, in total and per code path or event handler,
+ * or only of the one named, e.g. "xstats arrange". Needs the framed protocol
+ * like "stats". */
+int queryXStats(char * input, char * output) {
+	char name[32];
+
+	if (sscanf(input, "%31s", name) == 1)
+		return !xstats_format(name, output, MAXBUFF_QUERY);
+	xstats_format(NULL, output, MAXBUFF_QUERY);
+	return 0;
+}
+#endif /* XSTATS */
+
 QuerySignal query_funcs[] = {
 	{ "nummons", queryNumMon },
 	{ "selmon", querySelmon },
@@ -248,7 +306,14 @@ QuerySignal query_funcs[] = {
 	{ "layout", queryLayout },
 	{ "monlayout", queryLayoutMon },
 	{ "selwin", querySelWin },
-	{ "masterwin", queryMasterWin }
+	{ "masterwin", queryMasterWin },
+	{ "spawnstats", querySpawnStats },
+	{ "signal", querySignal },
+	{ "stats", queryStats },
+	{ "statsreset", queryStatsReset },
+#ifdef XSTATS
+	{ "xstats", queryXStats },
+#endif /* XSTATS */
 };
 CALC_SIZE(query_funcs);
 
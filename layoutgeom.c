@@ -0,0 +1,305 @@
+/* See LICENSE file for copyright and license details. */
+#include "layoutgeom.h"
+#include "util.h"
+
+static void
+cell(Rect *r, int x, int y, int w, int h)
+{
+	r->x = x;
+	r->y = y;
+	r->w = w;
+	r->h = h;
+}
+
+void
+tilegeom(const LayoutArea *a, unsigned int n, Rect *r)
+{
+	unsigned int i, h, mw, my, ty;
+
+	if (n == 0)
+		return;
+
+	if (n > a->nmaster)
+		mw = a->nmaster ? a->w * a->mfact : 0;
+	else
+		mw = a->w;
+	for (i = my = ty = 0; i < n; i++)
+		if (i < a->nmaster) {
+			h = (a->h - my) / (MIN(n, a->nmaster) - i);
+			cell(&r[i], a->x, a->y + my, mw, h);
+			if (my + h < a->h)
+				my += h;
+		} else {
+			h = (a->h - ty) / (n - i);
+			cell(&r[i], a->x + mw, a->y + ty, a->w - mw, h);
+			if (ty + h < a->h)
+				ty += h;
+		}
+}
+
+void
+monoclegeom(const LayoutArea *a, unsigned int n, Rect *r)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		cell(&r[i], a->x, a->y, a->w, a->h);
+}
+
+void
+gaplessgridgeom(const LayoutArea *a, unsigned int n, Rect *r)
+{
+	unsigned int cols, rows, cn, rn, i, cx, cy, cw, ch;
+
+	if(n == 0)
+		return;
+
+	/* grid dimensions */
+	for(cols = 0; cols <= n/2; cols++)
+		if(cols*cols >= n)
+			break;
+	if(n == 5) /* set layout against the general calculation: not 1:2:2, but 2:3 */
+		cols = 2;
+	rows = n/cols;
+
+	/* window geometries */
+	cw = cols ? a->w / cols : a->w;
+	cn = 0; /* current column number */
+	rn = 0; /* current row number */
+	for(i = 0; i < n; i++) {
+		if(i/rows + 1 > cols - n%cols)
+			rows = n/cols + 1;
+		ch = rows ? a->h / rows : a->h;
+		cx = a->x + cn*cw;
+		cy = a->y + rn*ch;
+		cell(&r[i], cx, cy, cw, ch);
+		rn++;
+		if(rn >= rows) {
+			rn = 0;
+			cn++;
+		}
+	}
+}
+
+static void
+fibonacci(const LayoutArea *a, unsigned int n, Rect *r, int s)
+{
+	unsigned int i, j;
+	int cx, cy, cw, ch, nw, nh;
+
+	cx = a->x;
+	cy = a->y;
+	cw = a->w;
+	ch = a->h;
+
+	/* i counts the cells that were split off, j all of them */
+	for(i = j = 0; j < n; j++) {
+		if((i % 2 && ch * a->mfact > 2 * a->bw)
+		   || (!(i % 2) && cw * a->mfact > 2 * a->bw)) {
+			nw = cw;
+			nh = ch;
+			if(i < n - 1) {
+				if(i % 2)
+					nh *= a->mfact;
+				else
+					nw *= a->mfact;
+			}
+
+			cell(&r[j], cx, cy, nw, nh);
+			if((i % 4) == 0) {
+				if ((cx - a->x) + nw < a->w)
+					cx += nw;
+			} else if((i % 4) == 1) {
+				if ((cy - a->y) + nh < a->h)
+					cy += nh;
+			} else if((i % 4) == 2) {
+				if(s) {
+					if ((cx - a->x) + nw < a->w)
+						cx += nw;
+				} else {
+					cx -= nw;
+				}
+			}
+			else if((i % 4) == 3) {
+				if(s) {
+					if ((cy - a->y) + nh < a->h)
+						cy += nh;
+				} else {
+					cy -= nh;
+				}
+			}
+
+			if (i % 2) {
+				if (ch - nh >= 0)
+					ch -= nh;
+			} else {
+				if (cw - nw >= 0)
+					cw -= nw;
+			}
+
+			i++;
+		} else {
+			cell(&r[j], cx, cy, cw, ch);
+		}
+	}
+}
+
+void
+dwindlegeom(const LayoutArea *a, unsigned int n, Rect *r)
+{
+	fibonacci(a, n, r, 1);
+}
+
+void
+spiralgeom(const LayoutArea *a, unsigned int n, Rect *r)
+{
+	fibonacci(a, n, r, 0);
+}
+
+void
+horizgridgeom(const LayoutArea *a, unsigned int n, Rect *r)
+{
+	unsigned int i;
+	int w = 0;
+	int ntop, nbottom = 0;
+
+	if(n == 0)
+		return;
+	else if(n == 1) { /* Just fill the whole screen */
+		cell(&r[0], a->x, a->y, a->w, a->h);
+	} else if(n == 2) { /* Split vertically */
+		w = a->w / 2;
+		cell(&r[0], a->x, a->y, w, a->h);
+		cell(&r[1], a->x + w, a->y, w, a->h);
+	} else {
+		ntop = n / 2;
+		nbottom = n - ntop;
+		for(i = 0; i < n; i++) {
+			if(i < ntop)
+				cell(&r[i], a->x + i * a->w / ntop, a->y, a->w / ntop, a->h / 2);
+			else
+				cell(&r[i], a->x + (i - ntop) * a->w / nbottom, a->y + a->h / 2, a->w / nbottom, a->h / 2);
+		}
+	}
+}
+
+void
+bstackgeom(const LayoutArea *a, unsigned int n, Rect *r)
+{
+	int w, h, mh, mx, tx, ty, tw;
+	unsigned int i;
+
+	if (n == 0)
+		return;
+	if (n > a->nmaster) {
+		mh = a->nmaster ? a->mfact * a->h : 0;
+		tw = a->w / (n - a->nmaster);
+		ty = a->y + mh;
+	} else {
+		mh = a->h;
+		tw = a->w;
+		ty = a->y;
+	}
+	for (i = mx = 0, tx = a->x; i < n; i++) {
+		if (i < a->nmaster) {
+			w = (a->w - mx) / (MIN(n, a->nmaster) - i);
+			cell(&r[i], a->x + mx, a->y, w, mh);
+			if (mx + w < a->w)
+				mx += w;
+		} else {
+			h = a->h - mh;
+			cell(&r[i], tx, ty, tw, h);
+			if (tx + tw < a->w)
+				tx += tw;
+		}
+	}
+}
+
+void
+bstackhorizgeom(const LayoutArea *a, unsigned int n, Rect *r)
+{
+	int w, mh, mx, tx, ty, th;
+	unsigned int i;
+
+	if (n == 0)
+		return;
+	if (n > a->nmaster) {
+		mh = a->nmaster ? a->mfact * a->h : 0;
+		th = (a->h - mh) / (n - a->nmaster);
+		ty = a->y + mh;
+	} else {
+		th = mh = a->h;
+		ty = a->y;
+	}
+	for (i = mx = 0, tx = a->x; i < n; i++) {
+		if (i < a->nmaster) {
+			w = (a->w - mx) / (MIN(n, a->nmaster) - i);
+			cell(&r[i], a->x + mx, a->y, w, mh);
+			mx += w;
+		} else {
+			cell(&r[i], tx, ty, a->w, th);
+			if (th != a->h)
+				ty += th;
+		}
+	}
+}
+
+void
+tclgeom(const LayoutArea *a, unsigned int n, Rect *r)
+{
+	int x, y, h, w, mw, sw, yl, yr;
+	unsigned int i, j, nn;
+
+	if (n == 0)
+		return;
+
+	nn = MIN(a->nmaster, n);
+	if (nn != 0)
+		mw = a->mfact * a->w;
+	else
+		mw = 0;
+	sw = (a->w - mw) / 2;
+	y = 0;
+	h = a->h;
+	for (i = 0; i < nn; i++) {
+		cell(&r[i],
+				n <= a->nmaster + 1 ? a->x : a->x + sw,
+				a->y + y,
+				n <= a->nmaster ? a->w : mw,
+				(h - y) / (nn - i));
+		if (y + r[i].h < a->h)
+			y += r[i].h;
+	}
+
+	n -= nn;
+	if (n == 0)
+		return;
+
+	if (n == 1) {
+		cell(&r[nn], a->x + mw, a->y, a->w - mw, a->h);
+		return;
+	}
+
+	w = sw;
+	yl = yr = 0;
+	for (i = 0, j = nn; i < n; i++, j++) {
+		if (i % 2 == 0) {
+			x = a->x;
+			y = yl;
+		} else {
+			x = a->x + sw + mw;
+			y = yr;
+		}
+		h = (a->h - y) / ((n - i + 1) / 2);
+
+		cell(&r[j], x, a->y + y, w, h);
+
+		if (i % 2 == 0) {
+			if (yl + h < a->h)
+				yl += h;
+		} else {
+			if (yr + h < a->h)
+				yr += h;
+		}
+	}
+}
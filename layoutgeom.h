@@ -0,0 +1,31 @@
+/* See LICENSE file for copyright and license details. */
+
+#ifndef LAYOUTGEOM_H
+#define LAYOUTGEOM_H
+
+/* The geometry of the layouts, free of X and of clients. Each function fills
+ * r with the cells of n tiled clients in the area a, in the order of the
+ * client list. A cell includes the border and the gaps around a client. */
+
+typedef struct {
+	int x, y, w, h;
+} Rect;
+
+typedef struct {
+	int x, y, w, h; /* window area of the monitor */
+	int nmaster;
+	float mfact;
+	int bw;         /* border width, fibonacci() splits no cell below it */
+} LayoutArea;
+
+void tilegeom(const LayoutArea *a, unsigned int n, Rect *r);
+void monoclegeom(const LayoutArea *a, unsigned int n, Rect *r);
+void gaplessgridgeom(const LayoutArea *a, unsigned int n, Rect *r);
+void dwindlegeom(const LayoutArea *a, unsigned int n, Rect *r);
+void spiralgeom(const LayoutArea *a, unsigned int n, Rect *r);
+void horizgridgeom(const LayoutArea *a, unsigned int n, Rect *r);
+void bstackgeom(const LayoutArea *a, unsigned int n, Rect *r);
+void bstackhorizgeom(const LayoutArea *a, unsigned int n, Rect *r);
+void tclgeom(const LayoutArea *a, unsigned int n, Rect *r);
+
+#endif /* LAYOUTGEOM_H */
@@ -12,6 +12,7 @@ void horizgrid(Monitor *m);
 void bstack(Monitor *m);
 void bstackhoriz(Monitor *m);
 void tcl(Monitor *m);
+void layouts_free(void);
 
 #endif /* LAYOUTS_H */
 
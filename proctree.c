@@ -0,0 +1,285 @@
+/* See LICENSE file for copyright and license details. */
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#endif /* __linux__ */
+#ifdef __FreeBSD__
+#include <sys/user.h>
+#include <libutil.h>
+#endif /* __FreeBSD__ */
+
+#include "proctree.h"
+#include "util.h"
+
+#define PROCTREE_MINSIZE 1024
+
+typedef struct {
+	pid_t pid, ppid;
+} ProcEntry;
+
+/* pid -> ppid, open addressing, pid 0 marks empty slots */
+static ProcEntry *tab;
+static unsigned int size, n;
+static int nlfd = -1;
+
+static pid_t
+readparent(pid_t p)
+{
+	unsigned int v = 0;
+
+#if defined(__linux__)
+	FILE *f;
+	char buf[256];
+	snprintf(buf, sizeof(buf) - 1, "/proc/%u/stat", (unsigned)p);
+
+	if (!(f = fopen(buf, "r")))
+		return (pid_t)0;
+
+	if (fscanf(f, "%*u %*s %*c %u", &v) != 1)
+		v = 0;
+	fclose(f);
+#elif defined(__FreeBSD__)
+	struct kinfo_proc *proc = kinfo_getproc(p);
+	if (!proc)
+		return (pid_t)0;
+
+	v = proc->ki_ppid;
+	free(proc);
+#endif
+	return (pid_t)v;
+}
+
+static ProcEntry *
+slot(pid_t pid)
+{
+	unsigned int i, mask = size - 1;
+
+	for (i = ((unsigned int)pid * 0x9e3779b1U) & mask;
+	     tab[i].pid && tab[i].pid != pid; i = (i + 1) & mask)
+		;
+	return &tab[i];
+}
+
+static void
+set(pid_t pid, pid_t ppid)
+{
+	ProcEntry *e, *old;
+	unsigned int i, oldsize;
+
+	if (pid <= 0)
+		return;
+	/* keep the load factor below one half, so probe chains stay short */
+	if (2 * (n + 1) > size) {
+		old = tab;
+		oldsize = size;
+		size *= 2;
+		tab = ecalloc(size, sizeof(ProcEntry));
+		for (i = 0; i < oldsize; i++)
+			if (old[i].pid)
+				*slot(old[i].pid) = old[i];
+		free(old);
+	}
+	e = slot(pid);
+	if (!e->pid) {
+		e->pid = pid;
+		n++;
+	}
+	e->ppid = ppid;
+}
+
+static void
+del(pid_t pid)
+{
+	unsigned int i, j, k, mask = size - 1;
+
+	if (pid <= 0)
+		return;
+	i = slot(pid) - tab;
+	if (!tab[i].pid)
+		return;
+	/* backward shift deletion, as in winmap_del() */
+	for (j = i;;) {
+		tab[i].pid = tab[i].ppid = 0;
+		do {
+			j = (j + 1) & mask;
+			if (!tab[j].pid) {
+				n--;
+				return;
+			}
+			k = ((unsigned int)tab[j].pid * 0x9e3779b1U) & mask;
+		} while (i <= j ? (i < k && k <= j) : (i < k || k <= j));
+		tab[i] = tab[j];
+		i = j;
+	}
+}
+
+#ifdef __linux__
+static int
+subscribe(void)
+{
+	struct sockaddr_nl sa;
+	union {
+		struct nlmsghdr hdr;
+		char buf[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))];
+	} req;
+	struct nlmsghdr *nlh = &req.hdr;
+	struct cn_msg *msg;
+	enum proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+	int fd;
+
+	if ((fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+	                 NETLINK_CONNECTOR)) == -1)
+		return -1;
+	memset(&sa, 0, sizeof(sa));
+	sa.nl_family = AF_NETLINK;
+	sa.nl_groups = CN_IDX_PROC;
+	sa.nl_pid = 0;
+	if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) == -1)
+		goto fail;
+
+	memset(&req, 0, sizeof(req));
+	nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(op));
+	nlh->nlmsg_type = NLMSG_DONE;
+	msg = NLMSG_DATA(nlh);
+	msg->id.idx = CN_IDX_PROC;
+	msg->id.val = CN_VAL_PROC;
+	msg->len = sizeof(op);
+	memcpy(msg->data, &op, sizeof(op));
+	/* listening needs CAP_NET_ADMIN, send() fails without it */
+	if (send(fd, nlh, nlh->nlmsg_len, 0) == -1)
+		goto fail;
+	return fd;
+
+fail:
+	close(fd);
+	return -1;
+}
+
+static void
+seed(void)
+{
+	DIR *d;
+	struct dirent *de;
+	char *end;
+	long pid;
+
+	if (!(d = opendir("/proc")))
+		return;
+	while ((de = readdir(d))) {
+		pid = strtol(de->d_name, &end, 10);
+		if (*end || pid <= 0)
+			continue;
+		set((pid_t)pid, readparent((pid_t)pid));
+	}
+	closedir(d);
+}
+
+/* Starts over from /proc, after events were lost. */
+static void
+reseed(void)
+{
+	memset(tab, 0, size * sizeof(ProcEntry));
+	n = 0;
+	seed();
+}
+#endif /* __linux__ */
+
+int
+proctree_init(void)
+{
+#ifdef __linux__
+	if ((nlfd = subscribe()) == -1)
+		return -1;
+	tab = ecalloc(PROCTREE_MINSIZE, sizeof(ProcEntry));
+	size = PROCTREE_MINSIZE;
+	n = 0;
+	/* after subscribing, so no fork can be missed in between */
+	seed();
+#endif /* __linux__ */
+	return nlfd;
+}
+
+void
+proctree_free(void)
+{
+	if (nlfd != -1)
+		close(nlfd);
+	nlfd = -1;
+	free(tab);
+	tab = NULL;
+	size = n = 0;
+}
+
+void
+proctree_read(void)
+{
+#ifdef __linux__
+	union {
+		struct nlmsghdr hdr;
+		char buf[4096];
+	} u;
+	struct nlmsghdr *nlh;
+	struct cn_msg *msg;
+	struct proc_event *ev;
+	ssize_t len;
+
+	if (nlfd == -1)
+		return;
+	for (;;) {
+		if ((len = recv(nlfd, u.buf, sizeof(u.buf), 0)) <= 0) {
+			/* the socket overflowed, forks and exits were dropped */
+			if (len == -1 && errno == ENOBUFS) {
+				reseed();
+				continue;
+			}
+			break;
+		}
+		for (nlh = &u.hdr; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+			if (nlh->nlmsg_type == NLMSG_ERROR || nlh->nlmsg_type == NLMSG_NOOP)
+				continue;
+			msg = NLMSG_DATA(nlh);
+			ev = (struct proc_event *)msg->data;
+			switch (ev->what) {
+			case PROC_EVENT_FORK:
+				/* new threads share the pid of their process */
+				if (ev->event_data.fork.child_pid == ev->event_data.fork.child_tgid)
+					set(ev->event_data.fork.child_tgid,
+					    ev->event_data.fork.parent_tgid);
+				break;
+			case PROC_EVENT_EXIT:
+				if (ev->event_data.exit.process_pid == ev->event_data.exit.process_tgid)
+					del(ev->event_data.exit.process_tgid);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+#endif /* __linux__ */
+}
+
+pid_t
+proctree_parent(pid_t pid)
+{
+	ProcEntry *e;
+	pid_t ppid;
+
+	if (pid <= 0)
+		return 0;
+	if (nlfd == -1)
+		return readparent(pid);
+	if ((e = slot(pid))->pid)
+		return e->ppid;
+	/* started before the events arrived, look it up once */
+	if ((ppid = readparent(pid)))
+		set(pid, ppid);
+	return ppid;
+}
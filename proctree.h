@@ -0,0 +1,20 @@
+/* See LICENSE file for copyright and license details. */
+
+#ifndef PROCTREE_H
+#define PROCTREE_H
+
+#include <sys/types.h>
+
+/* Cache of the parent of every process. On Linux it is seeded from /proc and
+ * kept current by the fork and exit events of the netlink proc connector.
+ * Without those events (other systems, or no CAP_NET_ADMIN), nothing is
+ * cached and every lookup reads the process table. */
+
+/* Returns a file descriptor to watch for events, or -1 if there are none. */
+int proctree_init(void);
+void proctree_free(void);
+/* Handles all pending events of the descriptor returned by proctree_init(). */
+void proctree_read(void);
+pid_t proctree_parent(pid_t pid);
+
+#endif /* PROCTREE_H */
@@ -0,0 +1,190 @@
+/* See LICENSE file for copyright and license details. */
+#include <stdlib.h>
+#include <string.h>
+
+#include "rules.h"
+#include "util.h"
+
+#define WORDBITS (8 * sizeof(unsigned long))
+
+enum { FieldTitle, FieldClass, FieldInstance, FieldLast };
+
+/* A complete DFA over byte classes: every state has a transition for every
+ * class, failure links are already folded in. out holds the rules whose
+ * pattern ends in a state, including all patterns that are suffixes of it. */
+typedef struct {
+	int *delta;          /* nstates * nclasses */
+	unsigned long *out;  /* nstates * nwords */
+	unsigned char *hasout;
+	int nstates;
+	unsigned long *wild; /* rules without a pattern for this field */
+} Automaton;
+
+static Automaton automata[FieldLast];
+/* bytes that occur in no pattern share class 0 */
+static unsigned char byteclass[256];
+static int nclasses;
+static size_t nrules, nwords;
+static unsigned long *found, *candidates;
+static unsigned int *matched;
+
+static const char *
+pattern(const Rule *r, int field)
+{
+	const char *p = field == FieldTitle ? r->title
+		: field == FieldClass ? r->class : r->instance;
+
+	/* strstr() matches the empty string everywhere */
+	return p && *p ? p : NULL;
+}
+
+static void
+build(Automaton *a, const Rule *rules, int field)
+{
+	size_t i, j, maxstates = 1;
+	int s, t, c, *fail, *queue, head = 0, tail = 0;
+	const unsigned char *p;
+
+	for (i = 0; i < nrules; i++)
+		if ((p = (const unsigned char *)pattern(&rules[i], field)))
+			maxstates += strlen((const char *)p);
+	a->delta = ecalloc(maxstates * nclasses, sizeof(int));
+	a->out = ecalloc(maxstates * nwords, sizeof(unsigned long));
+	a->hasout = ecalloc(maxstates, 1);
+	a->wild = ecalloc(nwords, sizeof(unsigned long));
+	fail = ecalloc(maxstates, sizeof(int));
+	queue = ecalloc(maxstates, sizeof(int));
+	/* -1 marks missing edges of the trie, 0 is the root */
+	memset(a->delta, -1, maxstates * nclasses * sizeof(int));
+	a->nstates = 1;
+
+	for (i = 0; i < nrules; i++) {
+		if (!(p = (const unsigned char *)pattern(&rules[i], field))) {
+			a->wild[i / WORDBITS] |= 1UL << (i % WORDBITS);
+			continue;
+		}
+		for (s = 0; *p; p++, s = t) {
+			c = byteclass[*p];
+			if ((t = a->delta[s * nclasses + c]) == -1)
+				t = a->delta[s * nclasses + c] = a->nstates++;
+		}
+		a->out[s * nwords + i / WORDBITS] |= 1UL << (i % WORDBITS);
+		a->hasout[s] = 1;
+	}
+
+	/* breadth first, so the failure state of s is complete before s */
+	for (c = 0; c < nclasses; c++) {
+		if ((t = a->delta[c]) == -1) {
+			a->delta[c] = 0;
+		} else {
+			fail[t] = 0;
+			queue[tail++] = t;
+		}
+	}
+	while (head < tail) {
+		s = queue[head++];
+		if (a->hasout[fail[s]]) {
+			for (j = 0; j < nwords; j++)
+				a->out[s * nwords + j] |= a->out[fail[s] * nwords + j];
+			a->hasout[s] = 1;
+		}
+		for (c = 0; c < nclasses; c++) {
+			if ((t = a->delta[s * nclasses + c]) == -1) {
+				a->delta[s * nclasses + c] = a->delta[fail[s] * nclasses + c];
+			} else {
+				fail[t] = a->delta[fail[s] * nclasses + c];
+				queue[tail++] = t;
+			}
+		}
+	}
+	free(fail);
+	free(queue);
+}
+
+/* Stores the rules matching str in found. */
+static void
+feed(const Automaton *a, const char *str)
+{
+	const unsigned char *p;
+	size_t j;
+	int s = 0;
+
+	memcpy(found, a->wild, nwords * sizeof(unsigned long));
+	for (p = (const unsigned char *)str; *p; p++) {
+		s = a->delta[s * nclasses + byteclass[*p]];
+		if (a->hasout[s])
+			for (j = 0; j < nwords; j++)
+				found[j] |= a->out[s * nwords + j];
+	}
+}
+
+void
+rules_compile(const Rule *rules, size_t n)
+{
+	size_t i;
+	int f;
+	const unsigned char *p;
+
+	rules_free();
+	nrules = n;
+	nwords = n / WORDBITS + 1;
+	nclasses = 1;
+	memset(byteclass, 0, sizeof(byteclass));
+	for (i = 0; i < n; i++)
+		for (f = 0; f < FieldLast; f++)
+			for (p = (const unsigned char *)pattern(&rules[i], f); p && *p; p++)
+				if (!byteclass[*p])
+					byteclass[*p] = nclasses++;
+	for (f = 0; f < FieldLast; f++)
+		build(&automata[f], rules, f);
+	found = ecalloc(nwords, sizeof(unsigned long));
+	candidates = ecalloc(nwords, sizeof(unsigned long));
+	matched = ecalloc(n + 1, sizeof(unsigned int));
+}
+
+void
+rules_free(void)
+{
+	int f;
+
+	for (f = 0; f < FieldLast; f++) {
+		free(automata[f].delta);
+		free(automata[f].out);
+		free(automata[f].hasout);
+		free(automata[f].wild);
+	}
+	memset(automata, 0, sizeof(automata));
+	free(found);
+	free(candidates);
+	free(matched);
+	found = candidates = NULL;
+	matched = NULL;
+	nrules = nwords = 0;
+}
+
+const unsigned int *
+rules_match(const char *title, const char *class, const char *instance, size_t *n)
+{
+	const char *str[FieldLast];
+	size_t i, j;
+	int f;
+
+	str[FieldTitle] = title;
+	str[FieldClass] = class;
+	str[FieldInstance] = instance;
+	*n = 0;
+	if (!nrules)
+		return matched;
+	for (j = 0; j < nwords; j++)
+		candidates[j] = ~0UL;
+	for (f = 0; f < FieldLast; f++) {
+		feed(&automata[f], str[f]);
+		for (j = 0; j < nwords; j++)
+			candidates[j] &= found[j];
+	}
+	for (j = 0; j < nwords; j++)
+		for (i = 0; candidates[j] && i < WORDBITS; i++)
+			if (candidates[j] & (1UL << i) && j * WORDBITS + i < nrules)
+				matched[(*n)++] = j * WORDBITS + i;
+	return matched;
+}
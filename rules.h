@@ -0,0 +1,21 @@
+/* See LICENSE file for copyright and license details. */
+
+#ifndef RULES_H
+#define RULES_H
+
+#include <stddef.h>
+
+#include "dwm.h"
+
+/* Rules are compiled into one Aho-Corasick automaton per field, so finding
+ * all rules whose title, class and instance are substrings of a window's
+ * strings takes one pass over each string, whatever the number of rules. */
+
+void rules_compile(const Rule *rules, size_t n);
+void rules_free(void);
+/* Returns the indices of all matching rules in ascending order, and stores
+ * their number in n. The array is valid until the next call. */
+const unsigned int *rules_match(const char *title, const char *class,
+                                const char *instance, size_t *n);
+
+#endif /* RULES_H */
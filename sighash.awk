@@ -0,0 +1,69 @@
+# Generates sighash.h, a perfect hash over the names in signals[] of
+# external_cmds.c, which fake_signal() uses to find a signal.
+# The hash has to match sighash() in dwm.c:
+#	h = (h * SIGHASH_MULT + c) % 1000003 for every byte c, then h % SIGHASH_SIZE
+
+BEGIN {
+	for (i = 0; i < 256; i++)
+		ord[sprintf("%c", i)] = i
+	n = 0
+}
+
+/^Signal signals\[\] = \{/ { insignals = 1; next }
+insignals && /^\};/ { insignals = 0 }
+insignals && /\{ *"/ {
+	match($0, /"[^"]*"/)
+	names[n++] = substr($0, RSTART + 1, RLENGTH - 2)
+}
+
+function hash(s, mult,    h, i) {
+	h = 0
+	for (i = 1; i <= length(s); i++)
+		h = (h * mult + ord[substr(s, i, 1)]) % 1000003
+	return h
+}
+
+END {
+	if (n == 0) {
+		print "sighash.awk: no signals found" > "/dev/stderr"
+		exit 1
+	}
+	for (size = 1; size < 2 * n; size *= 2)
+		;
+	# find a multiplier without collisions, grow the table if there is none
+	for (found = 0; !found; size *= 2) {
+		for (mult = 2; mult < 1000 && !found; mult++) {
+			split("", slot)
+			found = 1
+			for (i = 0; i < n; i++) {
+				h = hash(names[i], mult) % size
+				if (h in slot) {
+					found = 0
+					break
+				}
+				slot[h] = i
+			}
+		}
+		if (found)
+			break
+	}
+	mult--
+
+	print "/* generated by sighash.awk from external_cmds.c, do not edit */"
+	print "#ifndef SIGHASH_H"
+	print "#define SIGHASH_H"
+	print ""
+	printf "#define SIGHASH_MULT %d\n", mult
+	printf "#define SIGHASH_SIZE %d\n", size
+	print ""
+	print "/* index + 1 of the signal in signals[], 0 for unused slots */"
+	printf "static const unsigned char sighash_index[SIGHASH_SIZE] = {"
+	for (i = 0; i < size; i++) {
+		if (i % 16 == 0)
+			printf "\n\t"
+		printf "%d,%s", (i in slot) ? slot[i] + 1 : 0, (i % 16 == 15) ? "" : " "
+	}
+	print "\n};"
+	print ""
+	print "#endif /* SIGHASH_H */"
+}
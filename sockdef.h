@@ -3,9 +3,31 @@
 
 // static char * socket_path = "/home/fabian/.cache/dwm_socket";
 #define SOCKET_PATH "/home/fabian/.cache/dwm_socket"
+/* overrides SOCKET_PATH for dwm and dwmq, e.g. to run a second dwm */
+#define SOCKET_ENV "DWM_SOCKET"
 
 #define BACKLOG 5
 
+/* Size of the output of most query functions, and of a whole request in the
+ * old protocol, where every connection sends one request padded to this size
+ * and gets back an int status and the output padded or cut to this size. */
 #define MAXBUFF_SOCKET 64
 
+/* Requests and responses are framed by a native endian uint32_t holding the
+ * length of the rest of the frame. It is followed by a uint32_t id chosen by
+ * the client, which is repeated in the response. A request then holds the
+ * text "function args", a response an int32_t status and the output of the
+ * function, which may be up to MAXBUFF_QUERY - 1 bytes long. Connections
+ * stay open and may have many requests in flight. */
+#define MAXBUFF_QUERY 4096
+
+/* After "subscribe [tags|focus|layout|occ|urg|monitors ...]" dwm sends the
+ * current state and then every change as a response with this id, e.g.
+ * "tags 0 010000000" or "focus 0x1a00003". */
+#define SUBSCRIBE_EVENTID 0xffffffff
+
+/* Subscribers that let more than this many bytes of events pile up, because
+ * they stopped reading, are disconnected. */
+#define MAXBUFF_SUBSCRIBER (16 * MAXBUFF_QUERY)
+
 #endif /* SOCKDEF_H */
@@ -0,0 +1,136 @@
+/* See LICENSE file for copyright and license details. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+#include "util.h"
+
+#define TRUNCATED "...\n"
+
+static Stat **stats;
+static size_t nstats;
+
+static int
+fmtns(char *buf, size_t size, uint64_t ns)
+{
+	if (ns < 1000)
+		return snprintf(buf, size, "%luns", (unsigned long)ns);
+	if (ns < 1000000)
+		return snprintf(buf, size, "%luus", (unsigned long)(ns / 1000));
+	return snprintf(buf, size, "%lums", (unsigned long)(ns / 1000000));
+}
+
+/* Appends a line for s, returns 0 if it did not fit. */
+static int
+format(const Stat *s, char *out, size_t size, size_t *len)
+{
+	char avg[16], max[16], lo[16];
+	size_t l = *len;
+	int i, r;
+
+	fmtns(avg, sizeof(avg), s->count ? s->sum / s->count : 0);
+	fmtns(max, sizeof(max), s->max);
+	r = snprintf(out + l, size - l, "%s %lu avg %s max %s", s->name,
+	             s->count, avg, max);
+	if (r < 0 || (l += r) >= size)
+		return 0;
+	for (i = 0; i < STATS_BUCKETS; i++) {
+		if (!s->hist[i])
+			continue;
+		fmtns(lo, sizeof(lo), (uint64_t)1 << i);
+		r = snprintf(out + l, size - l, " %s:%lu", lo, s->hist[i]);
+		if (r < 0 || (l += r) >= size)
+			return 0;
+	}
+	if (l + 1 >= size)
+		return 0;
+	out[l++] = '\n';
+	out[l] = '\0';
+	*len = l;
+	return 1;
+}
+
+Stat *
+stats_new(const char *name)
+{
+	Stat *s = ecalloc(1, sizeof(Stat));
+
+	snprintf(s->name, sizeof(s->name), "%s", name);
+	if (!(stats = realloc(stats, (nstats + 1) * sizeof(Stat *))))
+		die("fatal: could not realloc() %u bytes\n",
+		    (nstats + 1) * sizeof(Stat *));
+	stats[nstats++] = s;
+	return s;
+}
+
+void
+stats_free(void)
+{
+	size_t i;
+
+	for (i = 0; i < nstats; i++)
+		free(stats[i]);
+	free(stats);
+	stats = NULL;
+	nstats = 0;
+}
+
+void
+stats_reset(void)
+{
+	size_t i;
+
+	for (i = 0; i < nstats; i++) {
+		stats[i]->count = 0;
+		stats[i]->sum = stats[i]->max = 0;
+		memset(stats[i]->hist, 0, sizeof(stats[i]->hist));
+	}
+}
+
+uint64_t
+stats_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void
+stats_add(Stat *s, uint64_t start)
+{
+	uint64_t d = stats_now() - start;
+	int i;
+
+	s->count++;
+	s->sum += d;
+	if (d > s->max)
+		s->max = d;
+	for (i = 0; i < STATS_BUCKETS - 1 && d >> (i + 1); i++)
+		;
+	s->hist[i]++;
+}
+
+int
+stats_format(const char *name, char *out, size_t size)
+{
+	size_t i, len = 0;
+	int n = 0;
+
+	out[0] = '\0';
+	if (size < sizeof(TRUNCATED))
+		return 0;
+	for (i = 0; i < nstats; i++) {
+		if (name ? strcmp(name, stats[i]->name) : !stats[i]->count)
+			continue;
+		/* keep room to mark the output as cut */
+		if (!format(stats[i], out, size - sizeof(TRUNCATED) + 1, &len)) {
+			strcpy(out + len, TRUNCATED); /* instead of the partial line */
+			break;
+		}
+		n++;
+	}
+	return n;
+}
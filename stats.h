@@ -0,0 +1,32 @@
+/* See LICENSE file for copyright and license details. */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Latency histograms of event handlers and other hot paths, shown by the
+ * "stats" query. Bucket i counts durations in [2^i, 2^(i+1)) ns, the last
+ * one also everything above. */
+#define STATS_BUCKETS 32
+
+typedef struct {
+	char name[24];
+	unsigned long count;
+	uint64_t sum, max; /* ns */
+	unsigned long hist[STATS_BUCKETS];
+} Stat;
+
+Stat *stats_new(const char *name);
+void stats_free(void);
+void stats_reset(void);
+uint64_t stats_now(void);
+/* Records the time since start, a value returned by stats_now(). */
+void stats_add(Stat *s, uint64_t start);
+/* Writes a line for every stat that counted something, or for the one named
+ * name, and returns the number of lines. Lines that do not fit are replaced
+ * by a last line "...". */
+int stats_format(const char *name, char *out, size_t size);
+
+#endif /* STATS_H */
@@ -16,6 +16,65 @@ ecalloc(size_t nmemb, size_t size)
 	return p;
 }
 
+void
+pool_init(Pool *p, size_t size, size_t perslab)
+{
+	/* every object must hold the free list link and stay pointer aligned */
+	size = MAX(size, sizeof(void *));
+	p->size = (size + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *);
+	p->perslab = perslab;
+	p->free = NULL;
+	p->slabs = NULL;
+	p->nslabs = 0;
+}
+
+/* Returns a zeroed object. */
+void *
+pool_alloc(Pool *p)
+{
+	char *slab;
+	void *obj;
+	size_t i;
+
+	if (!p->free) {
+		slab = ecalloc(p->perslab, p->size);
+		if (!(p->slabs = realloc(p->slabs, (p->nslabs + 1) * sizeof(void *))))
+			die("realloc:");
+		p->slabs[p->nslabs++] = slab;
+		/* objects are handed out in the order of their addresses */
+		for (i = p->perslab; i > 0; i--) {
+			*(void **)(slab + (i - 1) * p->size) = p->free;
+			p->free = slab + (i - 1) * p->size;
+		}
+	}
+	obj = p->free;
+	p->free = *(void **)obj;
+	memset(obj, 0, p->size);
+	return obj;
+}
+
+void
+pool_free(Pool *p, void *obj)
+{
+	if (!obj)
+		return;
+	*(void **)obj = p->free;
+	p->free = obj;
+}
+
+void
+pool_destroy(Pool *p)
+{
+	size_t i;
+
+	for (i = 0; i < p->nslabs; i++)
+		free(p->slabs[i]);
+	free(p->slabs);
+	p->slabs = NULL;
+	p->nslabs = 0;
+	p->free = NULL;
+}
+
 void
 die(const char *fmt, ...) {
 	va_list ap;
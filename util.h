@@ -13,8 +13,22 @@
 #define LENGTH(X)               (sizeof X / sizeof X[0])
 #define CALC_SIZE(X) const size_t CONCAT(X, _size) = LENGTH(X)
 
+/* Allocates objects of one size from slabs of perslab objects. Freed objects
+ * go on a free list and are reused first, slabs are only given back by
+ * pool_destroy(). */
+typedef struct {
+	size_t size, perslab;
+	void *free;
+	void **slabs;
+	size_t nslabs;
+} Pool;
+
 void die(const char *fmt, ...);
 void *ecalloc(size_t nmemb, size_t size);
+void pool_init(Pool *p, size_t size, size_t perslab);
+void *pool_alloc(Pool *p);
+void pool_free(Pool *p, void *obj);
+void pool_destroy(Pool *p);
 
 #endif /* UTIL_H */
 
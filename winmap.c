@@ -0,0 +1,112 @@
+/* See LICENSE file for copyright and license details. */
+#include <stdlib.h>
+
+#include "winmap.h"
+#include "util.h"
+
+#define WINMAP_MINSIZE 64
+
+static unsigned int
+winhash(Window w)
+{
+	unsigned int h = (unsigned int)(w ^ (w >> 16 >> 16));
+
+	/* XIDs of one client only differ in the low bits, so mix them up */
+	h = ((h >> 16) ^ h) * 0x45d9f3bU;
+	h = ((h >> 16) ^ h) * 0x45d9f3bU;
+	return (h >> 16) ^ h;
+}
+
+static WinMapEntry *
+winmap_slot(const WinMap *map, Window w)
+{
+	unsigned int i, mask = map->size - 1;
+
+	for (i = winhash(w) & mask; map->tab[i].win && map->tab[i].win != w; i = (i + 1) & mask)
+		;
+	return &map->tab[i];
+}
+
+static void
+winmap_resize(WinMap *map, unsigned int size)
+{
+	WinMapEntry *old = map->tab;
+	unsigned int i, oldsize = map->size;
+
+	map->tab = ecalloc(size, sizeof(WinMapEntry));
+	map->size = size;
+	for (i = 0; i < oldsize; i++)
+		if (old[i].win)
+			*winmap_slot(map, old[i].win) = old[i];
+	free(old);
+}
+
+void
+winmap_init(WinMap *map)
+{
+	map->tab = ecalloc(WINMAP_MINSIZE, sizeof(WinMapEntry));
+	map->size = WINMAP_MINSIZE;
+	map->n = 0;
+}
+
+void
+winmap_free(WinMap *map)
+{
+	free(map->tab);
+	map->tab = NULL;
+	map->size = map->n = 0;
+}
+
+Client *
+winmap_get(const WinMap *map, Window w)
+{
+	if (!w)
+		return NULL;
+	return winmap_slot(map, w)->c;
+}
+
+void
+winmap_set(WinMap *map, Window w, Client *c)
+{
+	WinMapEntry *e;
+
+	if (!w)
+		return;
+	/* keep the load factor below one half, so probe chains stay short */
+	if (2 * (map->n + 1) > map->size)
+		winmap_resize(map, 2 * map->size);
+	e = winmap_slot(map, w);
+	if (!e->win) {
+		e->win = w;
+		map->n++;
+	}
+	e->c = c;
+}
+
+void
+winmap_del(WinMap *map, Window w)
+{
+	unsigned int i, j, k, mask = map->size - 1;
+
+	if (!w)
+		return;
+	i = winmap_slot(map, w) - map->tab;
+	if (!map->tab[i].win)
+		return;
+	/* backward shift deletion, moves up all entries of the probe chain
+	 * that would become unreachable through the new hole */
+	for (j = i;;) {
+		map->tab[i].win = None;
+		map->tab[i].c = NULL;
+		do {
+			j = (j + 1) & mask;
+			if (!map->tab[j].win) {
+				map->n--;
+				return;
+			}
+			k = winhash(map->tab[j].win) & mask;
+		} while (i <= j ? (i < k && k <= j) : (i < k || k <= j));
+		map->tab[i] = map->tab[j];
+		i = j;
+	}
+}
@@ -0,0 +1,29 @@
+/* See LICENSE file for copyright and license details. */
+
+#ifndef WINMAP_H
+#define WINMAP_H
+
+#include <X11/Xlib.h>
+
+#include "dwm.h"
+
+/* Open addressing hash table mapping X windows to clients.
+ * None is used to mark empty slots and can therefore not be stored. */
+typedef struct {
+	Window win;
+	Client *c;
+} WinMapEntry;
+
+typedef struct {
+	WinMapEntry *tab;
+	unsigned int size; /* always a power of two */
+	unsigned int n;
+} WinMap;
+
+void winmap_init(WinMap *map);
+void winmap_free(WinMap *map);
+Client *winmap_get(const WinMap *map, Window w);
+void winmap_set(WinMap *map, Window w, Client *c);
+void winmap_del(WinMap *map, Window w);
+
+#endif /* WINMAP_H */